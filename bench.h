@@ -0,0 +1,203 @@
+/* Micro-benchmarks, a companion to yassert.h. */
+#ifndef BENCH_H
+# define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Time spent running the benchmark before measuring. */
+#ifndef BENCH_WARMUP_NS
+# define BENCH_WARMUP_NS       (20 * 1000 * 1000)
+#endif
+
+/* Iterations per sample are doubled until a sample takes at least
+   this long, so that the clock resolution doesn't matter. */
+#ifndef BENCH_MIN_SAMPLE_NS
+# define BENCH_MIN_SAMPLE_NS   (200 * 1000)
+#endif
+
+/* Number of samples, the p99 needs at least 100. */
+#ifndef BENCH_SAMPLES
+# define BENCH_SAMPLES         (101)
+#endif
+
+/* Keep the compiler from optimizing a value (or the computation that
+   produced it) away. */
+#if defined (__GNUC__)
+# define BENCH_DO_NOT_OPTIMIZE(val)				\
+	__asm__ __volatile__("" : : "g"(val) : "memory")
+# define BENCH_CLOBBER()					\
+	__asm__ __volatile__("" : : : "memory")
+#else
+/* For compilers that doesn't implements GNU extensions. */
+extern volatile uintptr_t bench_sink;
+# define BENCH_DO_NOT_OPTIMIZE(val)				\
+	do { bench_sink = (uintptr_t)(val); } while (0)
+# define BENCH_CLOBBER()    do { } while (0)
+#endif
+
+/* TSC ticks are only available on x86. */
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+# define BENCH_HAVE_TSC
+#endif
+
+/* The benchmarked function runs the operation iters times. */
+typedef void (*bench_fn)(void *arg, uint64_t iters);
+
+struct bench_result {
+	const char *name;
+	/* Iterations per sample. */
+	uint64_t iters;
+	/* Per operation, in nanoseconds. */
+	double min_ns;
+	double median_ns;
+	double p99_ns;
+	double mean_ns;
+	/* Median TSC ticks per operation, -1 without a TSC. */
+	double ticks;
+};
+
+/* Warm up, scale and run a benchmark. */
+extern void bench_do_run(const char *name, bench_fn fn, void *arg,
+			 struct bench_result *res);
+/* Print a result in a human readable form. */
+extern void bench_do_print(FILE *fp, const struct bench_result *res);
+/* Print the CSV header, then one line per result. */
+extern void bench_do_print_csv_header(FILE *fp);
+extern void bench_do_print_csv(FILE *fp, const struct bench_result *res);
+/* Print an array of results as a JSON array. */
+extern void bench_do_print_json(FILE *fp, const struct bench_result *res,
+				size_t n);
+
+#define BENCH_DO_RUN(name, fn, arg, res)	\
+	bench_do_run(name, fn, arg, res)
+
+#ifdef BENCH_IMPL
+
+#include <stdlib.h>
+#include <time.h>
+
+#if !defined (__GNUC__)
+volatile uintptr_t bench_sink;
+#endif
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+static uint64_t bench_ticks(void)
+{
+#ifdef BENCH_HAVE_TSC
+	uint32_t lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return (((uint64_t)hi << 32) | lo);
+#else
+	return (0);
+#endif /* BENCH_HAVE_TSC */
+}
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return ((x > y) - (x < y));
+}
+
+void bench_do_run(const char *name, bench_fn fn, void *arg,
+		  struct bench_result *res)
+{
+	double ns[BENCH_SAMPLES], ticks[BENCH_SAMPLES], sum;
+	uint64_t iters, start, t, elapsed;
+	size_t i;
+
+	/* Warmup, also doubles the iteration count until a sample is
+	   long enough. */
+	iters = 1;
+	start = bench_now_ns();
+	for (;;) {
+		t = bench_now_ns();
+		fn(arg, iters);
+		elapsed = bench_now_ns() - t;
+		if (elapsed < BENCH_MIN_SAMPLE_NS) {
+			iters *= 2;
+			continue;
+		}
+		if (bench_now_ns() - start >= BENCH_WARMUP_NS)
+			break;
+	}
+
+	sum = 0;
+	for (i = 0; i < BENCH_SAMPLES; i++) {
+		t = bench_ticks();
+		start = bench_now_ns();
+		fn(arg, iters);
+		elapsed = bench_now_ns() - start;
+		ticks[i] = (double)(bench_ticks() - t) / (double)iters;
+		ns[i] = (double)elapsed / (double)iters;
+		sum += ns[i];
+	}
+
+	qsort(ns, BENCH_SAMPLES, sizeof(double), bench_cmp_double);
+	qsort(ticks, BENCH_SAMPLES, sizeof(double), bench_cmp_double);
+
+	res->name = name;
+	res->iters = iters;
+	res->min_ns = ns[0];
+	res->median_ns = ns[BENCH_SAMPLES / 2];
+	res->p99_ns = ns[(BENCH_SAMPLES * 99 - 1) / 100];
+	res->mean_ns = sum / BENCH_SAMPLES;
+#ifdef BENCH_HAVE_TSC
+	res->ticks = ticks[BENCH_SAMPLES / 2];
+#else
+	res->ticks = -1;
+#endif /* BENCH_HAVE_TSC */
+}
+
+void bench_do_print(FILE *fp, const struct bench_result *res)
+{
+	fprintf(fp, "%-32s %10.2f ns/op (min %.2f, p99 %.2f)",
+		res->name, res->median_ns, res->min_ns, res->p99_ns);
+	if (res->ticks >= 0)
+		fprintf(fp, " %8.1f ticks/op", res->ticks);
+	fprintf(fp, "\n");
+}
+
+void bench_do_print_csv_header(FILE *fp)
+{
+	fprintf(fp, "name,iters,min_ns,median_ns,p99_ns,mean_ns,ticks\n");
+}
+
+void bench_do_print_csv(FILE *fp, const struct bench_result *res)
+{
+	fprintf(fp, "%s,%llu,%.3f,%.3f,%.3f,%.3f,%.1f\n", res->name,
+		(unsigned long long)res->iters, res->min_ns, res->median_ns,
+		res->p99_ns, res->mean_ns, res->ticks);
+}
+
+void bench_do_print_json(FILE *fp, const struct bench_result *res,
+			 size_t n)
+{
+	size_t i;
+
+	fprintf(fp, "[");
+	for (i = 0; i < n; i++) {
+		fprintf(fp, "%s\n  {\"name\": \"%s\", \"iters\": %llu, "
+			"\"min_ns\": %.3f, \"median_ns\": %.3f, "
+			"\"p99_ns\": %.3f, \"mean_ns\": %.3f, \"ticks\": %.1f}",
+			i == 0 ? "" : ",", res[i].name,
+			(unsigned long long)res[i].iters, res[i].min_ns,
+			res[i].median_ns, res[i].p99_ns, res[i].mean_ns,
+			res[i].ticks);
+	}
+	fprintf(fp, "\n]\n");
+}
+
+#endif /* BENCH_IMPL */
+
+#endif /* BENCH_H */
@@ -0,0 +1,94 @@
+/* Building then freeing a BENCH_LIST_LEN node sll, with malloc(3) and
+   with the thread's arena, the numbers quoted in arena.h. The node
+   allocator is picked at run time, so that both use the same code.
+   From the top directory:
+     cc -O2 -pthread -o bench_arena bench/bench_arena.c && ./bench_arena */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define SLL_NODE_MALLOC(size)    bench_node_malloc(size)
+#define SLL_NODE_FREE(node)      bench_node_free(node)
+
+#define ARENA_IMPL
+#define SLL_IMPL
+#define BENCH_IMPL
+#include "../arena.h"
+
+static int bench_use_arena;
+
+static inline void *bench_node_malloc(size_t size)
+{
+	return (bench_use_arena ? arena_do_self_alloc(size) : malloc(size));
+}
+
+static inline void bench_node_free(void *node)
+{
+	if (!bench_use_arena)
+		free(node);
+}
+
+#include "../sll.h"
+#include "../bench.h"
+
+#ifndef BENCH_LIST_LEN
+# define BENCH_LIST_LEN    (100000)
+#endif
+
+static int bench_data;
+
+static void bench_malloc(void *arg, uint64_t iters)
+{
+	struct sll_node *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		SLL_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			SLL_DO_PUSH_FRONT(head, &bench_data);
+		BENCH_DO_NOT_OPTIMIZE(head);
+		SLL_DO_FREE(head);
+	}
+}
+
+static void bench_arena(void *arg, uint64_t iters)
+{
+	struct arena *a;
+	struct arena_mark m;
+	struct sll_node *head;
+	size_t i;
+
+	(void)arg;
+	a = arena_do_self();
+	while (iters-- > 0) {
+		m = arena_do_mark(a);
+		SLL_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			SLL_DO_PUSH_FRONT(head, &bench_data);
+		BENCH_DO_NOT_OPTIMIZE(head);
+		arena_do_rewind(a, m);
+	}
+}
+
+int main(void)
+{
+	struct bench_result res;
+	double ns;
+
+	bench_use_arena = 0;
+	bench_do_run("malloc (push_front, sll_do_free)", bench_malloc, NULL,
+		     &res);
+	bench_do_print(stdout, &res);
+	ns = res.median_ns;
+	printf("  %.1f ns/node\n", res.median_ns / BENCH_LIST_LEN);
+
+	bench_use_arena = 1;
+	bench_do_run("arena (push_front, arena_do_rewind)", bench_arena, NULL,
+		     &res);
+	bench_do_print(stdout, &res);
+	printf("  %.1f ns/node, %.1f times faster\n",
+	       res.median_ns / BENCH_LIST_LEN, ns / res.median_ns);
+
+	return (0);
+}
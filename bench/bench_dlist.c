@@ -0,0 +1,118 @@
+/* Benchmarks of the doubly linked list. Every operation is on a list
+   of BENCH_LIST_LEN nodes, the time per node is printed below it.
+   From the top directory:
+     cc -O2 -o bench_dlist bench/bench_dlist.c && ./bench_dlist */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define DLIST_IMPL
+#define BENCH_IMPL
+#include "../dlist.h"
+#include "../bench.h"
+
+#ifndef BENCH_LIST_LEN
+# define BENCH_LIST_LEN    (1000)
+#endif
+
+static int bench_data[BENCH_LIST_LEN];
+
+/* Build the list from the front, then free it. */
+static void bench_push_front(void *arg, uint64_t iters)
+{
+	struct dlist *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		DLIST_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			DLIST_DO_PUSH_FRONT(head, &bench_data[i]);
+		BENCH_DO_NOT_OPTIMIZE(head);
+		DLIST_DO_FREE(head);
+	}
+}
+
+/* Pushing to the back walks the whole list every time. */
+static void bench_push_back(void *arg, uint64_t iters)
+{
+	struct dlist *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		DLIST_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			DLIST_DO_PUSH_BACK(head, &bench_data[i]);
+		BENCH_DO_NOT_OPTIMIZE(head);
+		DLIST_DO_FREE(head);
+	}
+}
+
+/* Build the list, then empty it from the front. The last node is
+   freed, dlist_do_delete_first() wants a next one. */
+static void bench_delete_first(void *arg, uint64_t iters)
+{
+	struct dlist *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		DLIST_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			DLIST_DO_PUSH_FRONT(head, &bench_data[i]);
+		while (head->next != NULL)
+			DLIST_DO_DELETE_FIRST(head);
+		DLIST_DO_FREE(head);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_count(void *arg, uint64_t iters)
+{
+	struct dlist **head = arg;
+	size_t n;
+
+	while (iters-- > 0) {
+		n = DLIST_DO_COUNT_NODES(*head);
+		BENCH_DO_NOT_OPTIMIZE(n);
+	}
+}
+
+static void bench_reverse(void *arg, uint64_t iters)
+{
+	struct dlist **head = arg;
+
+	while (iters-- > 0) {
+		DLIST_DO_REVERSE(*head);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_report(const char *name, bench_fn fn, void *arg)
+{
+	struct bench_result res;
+
+	bench_do_run(name, fn, arg, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.2f ns per node\n", res.median_ns / BENCH_LIST_LEN);
+}
+
+int main(void)
+{
+	struct dlist *head;
+	size_t i;
+
+	bench_report("push_front + free", bench_push_front, NULL);
+	bench_report("push_back + free", bench_push_back, NULL);
+	bench_report("push_front + delete_first", bench_delete_first, NULL);
+
+	DLIST_DO_INIT(head);
+	for (i = 0; i < BENCH_LIST_LEN; i++)
+		DLIST_DO_PUSH_FRONT(head, &bench_data[i]);
+	bench_report("count", bench_count, &head);
+	bench_report("reverse", bench_reverse, &head);
+	DLIST_DO_FREE(head);
+
+	return (0);
+}
@@ -0,0 +1,90 @@
+/* Latency of every insert of BENCH_NKEYS pointer keys, where the
+   incremental resize shows in the tail, and the lookup throughput of
+   the full map. Build with -DHMAP_REHASH_STEP=100000000 to resize all
+   at once, the numbers quoted in hmap.h.
+   From the top directory:
+     cc -O2 -o bench_hmap bench/bench_hmap.c && ./bench_hmap */
+
+#include <stdlib.h>
+
+#define HMAP_IMPL
+#define BENCH_IMPL
+#include "../hmap.h"
+#include "../bench.h"
+
+#ifndef BENCH_NKEYS
+# define BENCH_NKEYS    (4 * 1024 * 1024)
+#endif
+
+static int bench_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return ((x > y) - (x < y));
+}
+
+/* Keys 1 to BENCH_NKEYS, visited in a scattered order. */
+static const void *bench_key(uint64_t i)
+{
+	return ((const void *)(uintptr_t)((i * 2654435761ULL) %
+					  BENCH_NKEYS + 1));
+}
+
+static void bench_hit(void *arg, uint64_t iters)
+{
+	struct hmap *m = arg;
+	uint64_t i;
+
+	for (i = 0; i < iters; i++)
+		BENCH_DO_NOT_OPTIMIZE(hmap_do_get(m, bench_key(i)));
+}
+
+static void bench_miss(void *arg, uint64_t iters)
+{
+	struct hmap *m = arg;
+	uint64_t i;
+
+	for (i = 0; i < iters; i++)
+		BENCH_DO_NOT_OPTIMIZE(hmap_do_get(m, (const void *)(uintptr_t)
+						  (BENCH_NKEYS + 1 + i)));
+}
+
+int main(void)
+{
+	struct hmap m;
+	struct bench_result res;
+	uint64_t *lat, t;
+	size_t i;
+
+	if ((lat = malloc(BENCH_NKEYS * sizeof(*lat))) == NULL)
+		return (1);
+
+	hmap_do_init(&m, hmap_do_hash_ptr, hmap_do_eq_ptr);
+	for (i = 0; i < BENCH_NKEYS; i++) {
+		t = bench_now_ns();
+		if (hmap_do_put(&m, (const void *)(uintptr_t)(i + 1), &m) !=
+		    HMAP_ALL_OKAY)
+			return (1);
+		lat[i] = bench_now_ns() - t;
+	}
+
+	qsort(lat, BENCH_NKEYS, sizeof(*lat), bench_cmp_u64);
+	printf("insert (%d keys, rehash step %d): p50 %llu ns, "
+	       "p99 %llu ns, p99.9 %llu ns, max %.3f ms\n",
+	       BENCH_NKEYS, HMAP_REHASH_STEP,
+	       (unsigned long long)lat[BENCH_NKEYS / 2],
+	       (unsigned long long)lat[(size_t)BENCH_NKEYS * 99 / 100],
+	       (unsigned long long)lat[(size_t)BENCH_NKEYS * 999 / 1000],
+	       (double)lat[BENCH_NKEYS - 1] / 1e6);
+
+	bench_do_run("lookup hit", bench_hit, &m, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.1f M lookups/s\n", 1e3 / res.median_ns);
+	bench_do_run("lookup miss", bench_miss, &m, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.1f M lookups/s\n", 1e3 / res.median_ns);
+
+	hmap_do_free(&m);
+	free(lat);
+	return (0);
+}
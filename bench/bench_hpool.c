@@ -0,0 +1,148 @@
+/* Walking a BENCH_LIST_LEN node sll linked in random order, with the
+   nodes from malloc(3) and from a pool of each kind of slab: that's
+   where the dTLB misses show. The misses are counted with perfctr.h
+   when the kernel lets us.
+   From the top directory:
+     cc -O2 -o bench_hpool bench/bench_hpool.c && ./bench_hpool */
+
+#include <stdlib.h>
+
+#define PROCFS_IMPL
+#define HPOOL_IMPL
+#define SLL_IMPL
+#define BENCH_IMPL
+#define PERFCTR_IMPL
+#include "../linux/procfs.h"
+#include "../linux/hpool.h"
+#include "../sll.h"
+#include "../bench.h"
+#include "../linux/perfctr.h"
+
+/* 32 MB of 16 byte nodes, well past what the dTLB covers with 4 kB
+   pages. */
+#ifndef BENCH_LIST_LEN
+# define BENCH_LIST_LEN    (2 * 1024 * 1024)
+#endif
+
+static int bench_data;
+
+struct bench_list {
+	struct sll_node **nodes;
+	struct sll_node *head;
+};
+
+/* Link the nodes in a random, but reproducible, order. */
+static void bench_link(struct bench_list *bl)
+{
+	struct sll_node *t;
+	uint64_t x;
+	size_t i, j;
+
+	x = 88172645463325252ULL;
+	for (i = BENCH_LIST_LEN - 1; i > 0; i--) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		j = (size_t)(x % (i + 1));
+		t = bl->nodes[i];
+		bl->nodes[i] = bl->nodes[j];
+		bl->nodes[j] = t;
+	}
+
+	for (i = 0; i < BENCH_LIST_LEN; i++) {
+		bl->nodes[i]->data = &bench_data;
+		bl->nodes[i]->next = i + 1 < BENCH_LIST_LEN ?
+			bl->nodes[i + 1] : NULL;
+	}
+	bl->head = bl->nodes[0];
+}
+
+static void bench_walk(void *arg, uint64_t iters)
+{
+	struct bench_list *bl = arg;
+	struct sll_node *n;
+	size_t count;
+
+	while (iters-- > 0) {
+		count = 0;
+		for (n = bl->head; n != NULL; n = n->next)
+			count++;
+		BENCH_DO_NOT_OPTIMIZE(count);
+	}
+}
+
+static void bench_report(struct perf_ctrs *pc, const char *name,
+			 struct bench_list *bl)
+{
+	struct bench_result res;
+	struct perf_ctr_result pres;
+
+	bench_link(bl);
+	bench_do_run(name, bench_walk, bl, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.2f ns/node", res.median_ns / BENCH_LIST_LEN);
+	if (pc->navail > 0) {
+		perf_ctr_do_bench(pc, name, bench_walk, bl, 4, &pres);
+		if (pres.per_op[PERF_CTR_DTLB_MISSES] >= 0)
+			printf(", %.3f dTLB misses/node",
+			       pres.per_op[PERF_CTR_DTLB_MISSES] /
+			       BENCH_LIST_LEN);
+	}
+	printf("\n");
+}
+
+static void bench_pool(struct perf_ctrs *pc, struct bench_list *bl,
+		       const char *name, int flags, int kind)
+{
+	struct hpool hp;
+	char buf[64];
+	size_t i;
+
+	if (hpool_do_init(&hp, sizeof(struct sll_node), flags, NULL) !=
+	    HPOOL_ALL_OKAY)
+		return;
+	for (i = 0; i < BENCH_LIST_LEN; i++) {
+		if ((bl->nodes[i] = hpool_do_alloc(&hp)) == NULL) {
+			fprintf(stderr, "%s: out of memory\n", name);
+			hpool_do_destroy(&hp);
+			return;
+		}
+	}
+
+	/* Say so when the pool fell back to another kind of slab. */
+	if (hp.nslabs[kind] == 0)
+		snprintf(buf, sizeof(buf), "%s (got %s)", name,
+			 hpool_do_kind_name(hp.kind));
+	else
+		snprintf(buf, sizeof(buf), "%s", name);
+	bench_report(pc, buf, bl);
+	hpool_do_destroy(&hp);
+}
+
+int main(void)
+{
+	struct perf_ctrs pc;
+	struct bench_list bl;
+	size_t i;
+
+	if ((bl.nodes = malloc(BENCH_LIST_LEN * sizeof(*bl.nodes))) == NULL)
+		return (1);
+	perf_ctr_do_open(&pc);
+
+	for (i = 0; i < BENCH_LIST_LEN; i++) {
+		if ((bl.nodes[i] = malloc(sizeof(struct sll_node))) == NULL)
+			return (1);
+	}
+	bench_report(&pc, "malloc", &bl);
+	for (i = 0; i < BENCH_LIST_LEN; i++)
+		free(bl.nodes[i]);
+
+	bench_pool(&pc, &bl, "hpool normal", HPOOL_NO_HUGETLB | HPOOL_NO_THP,
+		   HPOOL_NORMAL);
+	bench_pool(&pc, &bl, "hpool thp", HPOOL_NO_HUGETLB, HPOOL_THP);
+	bench_pool(&pc, &bl, "hpool hugetlb", 0, HPOOL_HUGETLB);
+
+	perf_ctr_do_close(&pc);
+	free(bl.nodes);
+	return (0);
+}
@@ -0,0 +1,142 @@
+/* The C++ front-ends against std::forward_list, std::list and
+   std::vector, with the workloads of bench_sll.c, bench_dlist.c and
+   bench_ss.c: run those for the C versions. Times per node (or
+   element) are printed below each result.
+   From the top directory:
+     c++ -std=c++17 -O2 -o bench_hpp bench/bench_hpp.cpp && ./bench_hpp */
+
+#include <forward_list>
+#include <list>
+#include <vector>
+
+#define BENCH_IMPL
+#include "../bench.h"
+#include "../sll.hpp"
+#include "../dlist.hpp"
+#include "../ss.hpp"
+
+#ifndef BENCH_LIST_LEN
+# define BENCH_LIST_LEN    (1000)
+#endif
+
+/* Same as bench_ss.c. */
+#define BENCH_STACK_LEN    (9)
+
+/* Build a list from the front, then free it. */
+template <class List>
+static void bench_push_front(void *arg, uint64_t iters)
+{
+	(void)arg;
+	while (iters-- > 0) {
+		List l;
+
+		for (int i = 0; i < BENCH_LIST_LEN; i++)
+			l.push_front(i);
+		BENCH_DO_NOT_OPTIMIZE(&l);
+	}
+}
+
+template <class List>
+static void bench_push_back(void *arg, uint64_t iters)
+{
+	(void)arg;
+	while (iters-- > 0) {
+		List l;
+
+		for (int i = 0; i < BENCH_LIST_LEN; i++)
+			l.push_back(i);
+		BENCH_DO_NOT_OPTIMIZE(&l);
+	}
+}
+
+/* Walk the list, what the C versions' count does. */
+template <class List>
+static void bench_walk(void *arg, uint64_t iters)
+{
+	const List *l = static_cast<const List *>(arg);
+	long sum;
+
+	while (iters-- > 0) {
+		sum = 0;
+		for (int v : *l)
+			sum += v;
+		BENCH_DO_NOT_OPTIMIZE(sum);
+	}
+}
+
+template <class List>
+static void bench_reverse(void *arg, uint64_t iters)
+{
+	List *l = static_cast<List *>(arg);
+
+	while (iters-- > 0) {
+		l->reverse();
+		BENCH_CLOBBER();
+	}
+}
+
+template <class Stack>
+static void bench_stack(void *arg, uint64_t iters)
+{
+	Stack *s = static_cast<Stack *>(arg);
+
+	while (iters-- > 0) {
+		for (int i = 0; i < BENCH_STACK_LEN; i++)
+			s->push_back(i);
+		while (!s->empty())
+			s->pop_back();
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_report(const char *name, bench_fn fn, void *arg,
+			 double per)
+{
+	struct bench_result res;
+
+	bench_do_run(name, fn, arg, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.2f ns per node\n", res.median_ns / per);
+}
+
+template <class List, bool has_push_back = true>
+static void bench_list(const char *name)
+{
+	char buf[128];
+	List l;
+
+	snprintf(buf, sizeof(buf), "%s push_front + free", name);
+	bench_report(buf, bench_push_front<List>, nullptr, BENCH_LIST_LEN);
+	if constexpr (has_push_back) {
+		snprintf(buf, sizeof(buf), "%s push_back + free", name);
+		bench_report(buf, bench_push_back<List>, nullptr,
+			     BENCH_LIST_LEN);
+	}
+
+	for (int i = 0; i < BENCH_LIST_LEN; i++)
+		l.push_front(i);
+	snprintf(buf, sizeof(buf), "%s walk", name);
+	bench_report(buf, bench_walk<List>, &l, BENCH_LIST_LEN);
+	snprintf(buf, sizeof(buf), "%s reverse", name);
+	bench_report(buf, bench_reverse<List>, &l, BENCH_LIST_LEN);
+}
+
+int main()
+{
+	static ds::ss<int, BENCH_STACK_LEN + 1> ss;
+	static std::vector<int> v;
+
+	bench_list<ds::sll<int>>("ds::sll");
+	bench_list<std::forward_list<int>, false>("std::forward_list");
+	bench_list<ds::dlist<int>>("ds::dlist");
+	bench_list<std::list<int>>("std::list");
+
+	v.reserve(BENCH_STACK_LEN);
+	bench_report("ds::ss push_back + pop_back",
+		     bench_stack<ds::ss<int, BENCH_STACK_LEN + 1>>, &ss,
+		     BENCH_STACK_LEN);
+	bench_report("std::vector push_back + pop_back",
+		     bench_stack<std::vector<int>>, &v, BENCH_STACK_LEN);
+
+	return (0);
+}
@@ -0,0 +1,102 @@
+/* Throughput of the meminfo exporters, on the meminfo fixture.
+   From the top directory:
+     cc -O2 -o bench_memexport bench/bench_memexport.c && ./bench_memexport */
+
+#define MEMEXPORT_IMPL
+#define PROCFS_IMPL
+#define BENCH_IMPL
+#include "../linux/memexport.h"
+#include "../bench.h"
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+struct bench_export {
+	struct proc_meminfo mi;
+	struct proc_meminfo prev;
+	char text[8192];
+	uint8_t bin[MEMEXPORT_BINARY_MAX];
+	ssize_t n;
+};
+
+static void bench_text(void *arg, uint64_t iters)
+{
+	struct bench_export *e = arg;
+
+	while (iters-- > 0) {
+		e->n = memexport_do_text(&e->mi, e->text, sizeof(e->text));
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_binary(void *arg, uint64_t iters)
+{
+	struct bench_export *e = arg;
+
+	while (iters-- > 0) {
+		e->n = memexport_do_binary(&e->mi, NULL, e->bin, sizeof(e->bin));
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_binary_delta(void *arg, uint64_t iters)
+{
+	struct bench_export *e = arg;
+
+	while (iters-- > 0) {
+		e->n = memexport_do_binary(&e->mi, &e->prev, e->bin,
+					   sizeof(e->bin));
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_decode_delta(void *arg, uint64_t iters)
+{
+	struct bench_export *e = arg;
+	struct proc_meminfo out;
+
+	while (iters-- > 0) {
+		memexport_do_decode_binary(e->bin, (size_t)e->n, &e->prev, &out);
+		BENCH_DO_NOT_OPTIMIZE(&out);
+	}
+}
+
+static void bench_report(const char *name, bench_fn fn,
+			 struct bench_export *e)
+{
+	struct bench_result res;
+
+	bench_do_run(name, fn, e, &res);
+	bench_do_print(stdout, &res);
+	printf("  %zd bytes, %.0f MB/s, %.0f snapshots/s\n", e->n,
+	       (double)e->n / res.median_ns * 1e3, 1e9 / res.median_ns);
+}
+
+int main(void)
+{
+	static struct bench_export e;
+	struct proc_buf pb = { 0 };
+
+	if (proc_do_read_kv(&pb, FIXTURES "/proc/meminfo", proc_meminfo_kv,
+			    PROC_KV_NFIELDS(proc_meminfo_kv), &e.mi,
+			    sizeof(e.mi)) != PROC_KV_ALL_OKAY) {
+		fprintf(stderr, "%s: can't read\n", FIXTURES "/proc/meminfo");
+		return (1);
+	}
+	proc_do_buf_free(&pb);
+
+	/* A typical one second delta: a few fields move a little. */
+	e.prev = e.mi;
+	e.prev.mem_free += 2048;
+	e.prev.mem_avail += 1024;
+	e.prev.cached -= 512;
+	e.prev.dirty -= 64;
+	e.prev.committed_as += 4;
+
+	bench_report("text", bench_text, &e);
+	bench_report("binary", bench_binary, &e);
+	bench_report("binary delta", bench_binary_delta, &e);
+	bench_report("decode delta", bench_decode_delta, &e);
+	return (0);
+}
@@ -0,0 +1,92 @@
+/* Benchmarks of the /proc/meminfo readers: the kv engine with a reused
+   buffer, and the legacy API that allocates on every read.
+   From the top directory:
+     cc -O2 -o bench_meminfo bench/bench_meminfo.c && ./bench_meminfo */
+
+#include <stdlib.h>
+
+#define MEMINFO_IMPL
+#define BENCH_IMPL
+#include "../linux/meminfo.h"
+#include "../bench.h"
+
+struct bench_meminfo {
+	struct proc_buf pb;
+	struct proc_meminfo mi;
+};
+
+static void bench_read(void *arg, uint64_t iters)
+{
+	struct bench_meminfo *b = arg;
+
+	while (iters-- > 0) {
+		proc_do_read_meminfo(&b->pb, &b->mi);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_legacy_collect_all(void *arg, uint64_t iters)
+{
+	struct bench_meminfo *b = arg;
+	char *p;
+
+	while (iters-- > 0) {
+		if (proc_do_init_meminfo(&b->mi, &p) != PROC_MEMINFO_ALL_OKAY)
+			continue;
+		proc_do_collect_all(&b->mi, p);
+		free(p);
+		BENCH_CLOBBER();
+	}
+}
+
+/* A single key, the common use of the legacy API. */
+static void bench_legacy_get_kv(void *arg, uint64_t iters)
+{
+	struct bench_meminfo *b = arg;
+	char *p;
+
+	while (iters-- > 0) {
+		if (proc_do_init_meminfo(&b->mi, &p) != PROC_MEMINFO_ALL_OKAY)
+			continue;
+		proc_do_get_kv(p, "MemAvailable:", &b->mi.mem_avail);
+		free(p);
+		BENCH_CLOBBER();
+	}
+}
+
+/* The parse alone, on a buffer read once. */
+static void bench_parse(void *arg, uint64_t iters)
+{
+	struct bench_meminfo *b = arg;
+
+	while (iters-- > 0) {
+		memset(&b->mi, '\0', sizeof(b->mi));
+		proc_do_parse_kv(b->pb.data, b->pb.len, proc_meminfo_kv,
+				 PROC_KV_NFIELDS(proc_meminfo_kv), &b->mi);
+		BENCH_CLOBBER();
+	}
+}
+
+int main(void)
+{
+	static struct bench_meminfo b;
+	struct bench_result res;
+
+	if (proc_do_read_meminfo(&b.pb, &b.mi) != PROC_KV_ALL_OKAY) {
+		fprintf(stderr, "%s: can't read\n", PROC_MEMINFO_PATH);
+		return (1);
+	}
+
+	bench_do_run("read_meminfo", bench_read, &b, &res);
+	bench_do_print(stdout, &res);
+	bench_do_run("parse_kv", bench_parse, &b, &res);
+	bench_do_print(stdout, &res);
+	bench_do_run("init_meminfo + collect_all", bench_legacy_collect_all,
+		     &b, &res);
+	bench_do_print(stdout, &res);
+	bench_do_run("init_meminfo + get_kv", bench_legacy_get_kv, &b, &res);
+	bench_do_print(stdout, &res);
+
+	proc_do_buf_free(&b.pb);
+	return (0);
+}
@@ -0,0 +1,102 @@
+/* Latency of one tick of reads: opening and reading every file, the
+   pread(2) batch, and the io_uring batch.
+   From the top directory:
+     cc -O2 -o bench_procbatch bench/bench_procbatch.c && ./bench_procbatch */
+
+#define PROCBATCH_IMPL
+#define PROCFS_IMPL
+#define BENCH_IMPL
+#include "../linux/procbatch.h"
+#include "../bench.h"
+
+static const char *bench_paths[] = {
+	"/proc/meminfo",
+	"/proc/vmstat",
+	"/proc/pressure/memory",
+	"/sys/fs/cgroup/memory.current",
+	"/sys/fs/cgroup/memory.stat",
+};
+
+struct bench_tick {
+	const char *paths[PROC_KV_NFIELDS(bench_paths)];
+	size_t n;
+	struct proc_buf pb;
+	struct proc_batch b;
+};
+
+/* What the readers do without a batch: open, read and close. */
+static void bench_open_read(void *arg, uint64_t iters)
+{
+	struct bench_tick *t = arg;
+	size_t i;
+
+	while (iters-- > 0) {
+		for (i = 0; i < t->n; i++)
+			proc_do_buf_read(&t->pb, t->paths[i]);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_batch(void *arg, uint64_t iters)
+{
+	struct bench_tick *t = arg;
+
+	while (iters-- > 0) {
+		proc_batch_do_read(&t->b);
+		BENCH_CLOBBER();
+	}
+}
+
+static int bench_batch_init(struct bench_tick *t, int flags)
+{
+	size_t i;
+
+	proc_batch_do_init(&t->b, flags);
+	for (i = 0; i < t->n; i++) {
+		if (proc_batch_do_add(&t->b, t->paths[i]) < 0)
+			return (-1);
+	}
+	return (0);
+}
+
+int main(void)
+{
+	static struct bench_tick t;
+	struct bench_result res;
+	char name[64];
+	size_t i;
+
+	/* Only the files of this system. */
+	for (i = 0; i < PROC_KV_NFIELDS(bench_paths); i++) {
+		if (access(bench_paths[i], R_OK) == 0)
+			t.paths[t.n++] = bench_paths[i];
+		else
+			fprintf(stderr, "%s: skipped\n", bench_paths[i]);
+	}
+
+	snprintf(name, sizeof(name), "open+read+close, %zu files", t.n);
+	bench_do_run(name, bench_open_read, &t, &res);
+	bench_do_print(stdout, &res);
+	printf("  %zu syscalls per tick\n", t.n * 3);
+	proc_do_buf_free(&t.pb);
+
+	if (bench_batch_init(&t, 0) == 0) {
+		snprintf(name, sizeof(name), "pread batch, %zu files", t.n);
+		bench_do_run(name, bench_batch, &t, &res);
+		bench_do_print(stdout, &res);
+		printf("  %zu syscalls per tick\n", t.n);
+	}
+	proc_batch_do_close(&t.b);
+
+	if (bench_batch_init(&t, PROC_BATCH_IO_URING) == 0 && t.b.use_uring) {
+		snprintf(name, sizeof(name), "io_uring batch, %zu files", t.n);
+		bench_do_run(name, bench_batch, &t, &res);
+		bench_do_print(stdout, &res);
+		printf("  1 syscall per tick\n");
+	} else {
+		fprintf(stderr, "io_uring: not available\n");
+	}
+	proc_batch_do_close(&t.b);
+
+	return (0);
+}
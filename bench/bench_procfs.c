@@ -0,0 +1,116 @@
+/* Per-file benchmarks of the /proc readers: a whole sample (pread of
+   the live file and parse), and the parse alone on a fixture.
+   From the top directory:
+     cc -O2 -o bench_procfs bench/bench_procfs.c && ./bench_procfs */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PROCFS_IMPL
+#define BENCH_IMPL
+#include "../linux/procfs.h"
+#include "../bench.h"
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+struct bench_file {
+	const char *name;
+	const char *path;
+	const char *fixture;
+	const struct proc_kv_field *tbl;
+	size_t n;
+	size_t size;
+	int fd;
+	struct proc_buf pb;
+	/* Big enough for any of the structures. */
+	uint64_t dst[64];
+};
+
+static void bench_sample(void *arg, uint64_t iters)
+{
+	struct bench_file *f = arg;
+
+	while (iters-- > 0) {
+		proc_do_buf_pread(&f->pb, f->fd);
+		memset(f->dst, '\0', f->size);
+		proc_do_parse_kv(f->pb.data, f->pb.len, f->tbl, f->n, f->dst);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_parse(void *arg, uint64_t iters)
+{
+	struct bench_file *f = arg;
+
+	while (iters-- > 0) {
+		memset(f->dst, '\0', f->size);
+		proc_do_parse_kv(f->pb.data, f->pb.len, f->tbl, f->n, f->dst);
+		BENCH_CLOBBER();
+	}
+}
+
+/* The legacy strstr(3) based meminfo parser, for comparison. */
+static void bench_parse_legacy(void *arg, uint64_t iters)
+{
+	struct bench_file *f = arg;
+
+	while (iters-- > 0) {
+		proc_do_collect_all((struct proc_meminfo *)f->dst, f->pb.data);
+		BENCH_CLOBBER();
+	}
+}
+
+#define BENCH_FILE(name, path, fixture, tbl, type)			\
+	{ name, path, FIXTURES fixture, tbl, PROC_KV_NFIELDS(tbl),	\
+	  sizeof(type), -1, { NULL, 0, 0 }, { 0 } }
+
+int main(void)
+{
+	static struct bench_file files[] = {
+		BENCH_FILE("meminfo", PROC_MEMINFO_PATH, "/proc/meminfo",
+			   proc_meminfo_kv, struct proc_meminfo),
+		BENCH_FILE("vmstat", PROC_VMSTAT_PATH, "/proc/vmstat",
+			   proc_vmstat_kv, struct proc_vmstat),
+		BENCH_FILE("self/status", PROC_SELF_STATUS_PATH,
+			   "/proc/self_status", proc_self_status_kv,
+			   struct proc_self_status),
+		BENCH_FILE("self/smaps_rollup", PROC_SMAPS_ROLLUP_PATH,
+			   "/proc/smaps_rollup", proc_smaps_rollup_kv,
+			   struct proc_smaps_rollup),
+		BENCH_FILE("stat", PROC_STAT_PATH, "/proc/stat",
+			   proc_stat_kv, struct proc_stat),
+	};
+	struct bench_result res;
+	char name[64];
+	size_t i;
+
+	for (i = 0; i < PROC_KV_NFIELDS(files); i++) {
+		if ((files[i].fd = open(files[i].path, O_RDONLY)) == -1) {
+			fprintf(stderr, "%s: can't open\n", files[i].path);
+			continue;
+		}
+		snprintf(name, sizeof(name), "%s sample", files[i].name);
+		bench_do_run(name, bench_sample, &files[i], &res);
+		bench_do_print(stdout, &res);
+		close(files[i].fd);
+
+		if (proc_do_buf_read(&files[i].pb, files[i].fixture) !=
+		    PROC_KV_ALL_OKAY) {
+			fprintf(stderr, "%s: can't read\n", files[i].fixture);
+			continue;
+		}
+		snprintf(name, sizeof(name), "%s parse", files[i].name);
+		bench_do_run(name, bench_parse, &files[i], &res);
+		bench_do_print(stdout, &res);
+		if (i == 0) {
+			bench_do_run("meminfo parse (collect_all)",
+				     bench_parse_legacy, &files[i], &res);
+			bench_do_print(stdout, &res);
+		}
+		proc_do_buf_free(&files[i].pb);
+	}
+
+	return (0);
+}
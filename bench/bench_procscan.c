@@ -0,0 +1,59 @@
+/* Scaling of the /proc/[pid] scanner with the number of workers.
+   The tree to scan can be given, /proc by default.
+   From the top directory:
+     cc -O2 -pthread -o bench_procscan bench/bench_procscan.c && ./bench_procscan */
+
+#define PROCSCAN_IMPL
+#define PROCFS_IMPL
+#define BENCH_IMPL
+#include "../linux/procscan.h"
+#include "../bench.h"
+
+#ifndef BENCH_PROCSCAN_TOP
+# define BENCH_PROCSCAN_TOP    (20)
+#endif
+
+struct bench_scan {
+	const char *root;
+	size_t nworkers;
+	struct procscan_entry out[BENCH_PROCSCAN_TOP];
+	int n;
+};
+
+static void bench_scan(void *arg, uint64_t iters)
+{
+	struct bench_scan *s = arg;
+
+	while (iters-- > 0) {
+		s->n = procscan_do_top(s->root, s->nworkers, s->out,
+				       BENCH_PROCSCAN_TOP);
+		BENCH_CLOBBER();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_scan s;
+	struct bench_result res;
+	char name[64];
+	double base;
+
+	s.root = argc > 1 ? argv[1] : PROCSCAN_ROOT_PATH;
+	base = 0;
+	for (s.nworkers = 1; s.nworkers <= PROCSCAN_MAX_WORKERS;
+	     s.nworkers *= 2) {
+		snprintf(name, sizeof(name), "top %d, %zu workers",
+			 BENCH_PROCSCAN_TOP, s.nworkers);
+		bench_do_run(name, bench_scan, &s, &res);
+		bench_do_print(stdout, &res);
+		if (s.n < 0) {
+			fprintf(stderr, "%s: can't scan\n", s.root);
+			return (1);
+		}
+		if (s.nworkers == 1)
+			base = res.median_ns;
+		printf("  speedup %.2fx\n", base / res.median_ns);
+	}
+
+	return (0);
+}
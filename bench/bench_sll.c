@@ -0,0 +1,116 @@
+/* Benchmarks of the singly linked list. Every operation is on a list
+   of BENCH_LIST_LEN nodes, the time per node is printed below it.
+   From the top directory:
+     cc -O2 -o bench_sll bench/bench_sll.c && ./bench_sll */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define SLL_IMPL
+#define BENCH_IMPL
+#include "../sll.h"
+#include "../bench.h"
+
+#ifndef BENCH_LIST_LEN
+# define BENCH_LIST_LEN    (1000)
+#endif
+
+static int bench_data[BENCH_LIST_LEN];
+
+/* Build the list from the front, then free it. */
+static void bench_push_front(void *arg, uint64_t iters)
+{
+	struct sll_node *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		SLL_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			SLL_DO_PUSH_FRONT(head, &bench_data[i]);
+		BENCH_DO_NOT_OPTIMIZE(head);
+		SLL_DO_FREE(head);
+	}
+}
+
+/* Pushing to the back walks the whole list every time. */
+static void bench_push_back(void *arg, uint64_t iters)
+{
+	struct sll_node *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		SLL_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			SLL_DO_PUSH_BACK(head, &bench_data[i]);
+		BENCH_DO_NOT_OPTIMIZE(head);
+		SLL_DO_FREE(head);
+	}
+}
+
+static void bench_count(void *arg, uint64_t iters)
+{
+	struct sll_node **head = arg;
+	size_t n;
+
+	while (iters-- > 0) {
+		n = SLL_DO_COUNT_LISTS(*head);
+		BENCH_DO_NOT_OPTIMIZE(n);
+	}
+}
+
+static void bench_reverse(void *arg, uint64_t iters)
+{
+	struct sll_node **head = arg;
+
+	while (iters-- > 0) {
+		SLL_DO_REVERSE_LIST(*head);
+		BENCH_CLOBBER();
+	}
+}
+
+/* Build the list, then empty it from the front. */
+static void bench_remove_first(void *arg, uint64_t iters)
+{
+	struct sll_node *head;
+	size_t i;
+
+	(void)arg;
+	while (iters-- > 0) {
+		SLL_DO_INIT(head);
+		for (i = 0; i < BENCH_LIST_LEN; i++)
+			SLL_DO_PUSH_FRONT(head, &bench_data[i]);
+		while (head != NULL)
+			SLL_DO_REMOVE_FIRST(head);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_report(const char *name, bench_fn fn, void *arg)
+{
+	struct bench_result res;
+
+	bench_do_run(name, fn, arg, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.2f ns per node\n", res.median_ns / BENCH_LIST_LEN);
+}
+
+int main(void)
+{
+	struct sll_node *head;
+	size_t i;
+
+	bench_report("push_front + free", bench_push_front, NULL);
+	bench_report("push_back + free", bench_push_back, NULL);
+	bench_report("push_front + remove_first", bench_remove_first, NULL);
+
+	SLL_DO_INIT(head);
+	for (i = 0; i < BENCH_LIST_LEN; i++)
+		SLL_DO_PUSH_FRONT(head, &bench_data[i]);
+	bench_report("count", bench_count, &head);
+	bench_report("reverse", bench_reverse, &head);
+	SLL_DO_FREE(head);
+
+	return (0);
+}
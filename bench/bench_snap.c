@@ -0,0 +1,147 @@
+/* Startup time from a snapshot of BENCH_NELEMS elements of 32 bytes,
+   the numbers quoted in snap.h: opening with and without the
+   checksum, walking it in place and thawing it into a dlist, against
+   building the same dlist with malloc(3) node by node. The snapshot
+   is in the page cache, each step is the median of BENCH_ROUNDS, and
+   the memory is given back between them.
+   From the top directory:
+     cc -O2 -o bench_snap bench/bench_snap.c && ./bench_snap */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+#define SLL_IMPL
+#define DLIST_IMPL
+#define SS_IMPL
+#define SNAP_IMPL
+#define BENCH_IMPL
+#include "../snap.h"
+#include "../bench.h"
+
+#ifndef BENCH_NELEMS
+# define BENCH_NELEMS       (4 * 1024 * 1024)
+#endif
+
+#ifndef BENCH_ROUNDS
+# define BENCH_ROUNDS       (5)
+#endif
+
+#ifndef BENCH_SNAP_PATH
+# define BENCH_SNAP_PATH    "/tmp/bench_snap.snap"
+#endif
+
+#define BENCH_ELEM_SIZE     (32)
+
+static int bench_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return ((x > y) - (x < y));
+}
+
+/* The list of the elements of src, the data copied as well. */
+static struct dlist *bench_build(char *src)
+{
+	struct dlist *head;
+	void *d;
+	size_t i;
+
+	DLIST_DO_INIT(head);
+	for (i = BENCH_NELEMS; i-- > 0; ) {
+		if ((d = malloc(BENCH_ELEM_SIZE)) == NULL)
+			exit(1);
+		memcpy(d, src + i * BENCH_ELEM_SIZE, BENCH_ELEM_SIZE);
+		DLIST_DO_PUSH_FRONT(head, d);
+	}
+	return (head);
+}
+
+/* Give the heap back, so that the next build faults its pages in
+   like a process that just started. */
+static void bench_free(struct dlist *head)
+{
+	DLIST_DO_FREE_DATA(head);
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+
+static void bench_report(const char *name, uint64_t *ns)
+{
+	qsort(ns, BENCH_ROUNDS, sizeof(*ns), bench_cmp_u64);
+	printf("%-28s %10.2f ms (min %.2f)\n", name,
+	       (double)ns[BENCH_ROUNDS / 2] / 1e6, (double)ns[0] / 1e6);
+}
+
+int main(void)
+{
+	uint64_t open_ns[BENCH_ROUNDS], open_nv_ns[BENCH_ROUNDS];
+	uint64_t walk_ns[BENCH_ROUNDS], thaw_ns[BENCH_ROUNDS];
+	uint64_t build_ns[BENCH_ROUNDS], t, sum;
+	const struct snap_rec *r;
+	struct dlist *head;
+	struct snap s;
+	char *src;
+	void *block;
+	size_t i;
+
+	if ((src = malloc((size_t)BENCH_NELEMS * BENCH_ELEM_SIZE)) == NULL)
+		return (1);
+	for (i = 0; i < (size_t)BENCH_NELEMS * BENCH_ELEM_SIZE; i++)
+		src[i] = (char)i;
+	head = bench_build(src);
+	if (snap_do_write_dlist(BENCH_SNAP_PATH, head, BENCH_ELEM_SIZE,
+				NULL) != SNAP_ALL_OKAY) {
+		fprintf(stderr, "%s: can't write\n", BENCH_SNAP_PATH);
+		return (1);
+	}
+	bench_free(head);
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		t = bench_now_ns();
+		if (snap_do_open(&s, BENCH_SNAP_PATH, 0) != SNAP_ALL_OKAY)
+			return (1);
+		open_ns[i] = bench_now_ns() - t;
+		snap_do_close(&s);
+
+		t = bench_now_ns();
+		if (snap_do_open(&s, BENCH_SNAP_PATH, SNAP_NO_VERIFY) !=
+		    SNAP_ALL_OKAY)
+			return (1);
+		open_nv_ns[i] = bench_now_ns() - t;
+
+		t = bench_now_ns();
+		sum = 0;
+		SNAP_DO_FOREACH(&s, r)
+			sum += *(const uint64_t *)snap_do_data(r);
+		BENCH_DO_NOT_OPTIMIZE(sum);
+		walk_ns[i] = bench_now_ns() - t;
+
+		t = bench_now_ns();
+		if (snap_do_thaw_dlist(&s, &head, &block) != SNAP_ALL_OKAY)
+			return (1);
+		thaw_ns[i] = bench_now_ns() - t;
+		SNAP_FREE(block);
+		snap_do_close(&s);
+
+		t = bench_now_ns();
+		head = bench_build(src);
+		build_ns[i] = bench_now_ns() - t;
+		bench_free(head);
+	}
+
+	printf("%d elements of %d bytes\n", BENCH_NELEMS, BENCH_ELEM_SIZE);
+	bench_report("open", open_ns);
+	bench_report("open (SNAP_NO_VERIFY)", open_nv_ns);
+	bench_report("walk in place", walk_ns);
+	bench_report("thaw into a dlist", thaw_ns);
+	bench_report("malloc() node by node", build_ns);
+
+	unlink(BENCH_SNAP_PATH);
+	free(src);
+	return (0);
+}
@@ -0,0 +1,91 @@
+/* Benchmarks of the static stack. Every operation fills or walks a
+   stack of BENCH_STACK_LEN elements, the time per element is printed
+   below it.
+   From the top directory:
+     cc -O2 -o bench_ss bench/bench_ss.c && ./bench_ss */
+
+#include <stddef.h>
+
+#define BENCH_IMPL
+#include "../ss.h"
+#include "../bench.h"
+
+/* ss_do_pop_front() looks one slot past the last element. */
+#define BENCH_STACK_LEN    (MAX_STACK_SIZE - 1)
+
+static int bench_data[BENCH_STACK_LEN];
+
+static void bench_push_back(void *arg, uint64_t iters)
+{
+	struct ss *ss = arg;
+	size_t i;
+
+	while (iters-- > 0) {
+		for (i = 0; i < BENCH_STACK_LEN; i++)
+			ss_do_push_back(ss, &bench_data[i]);
+		while (ss_do_pop_back(ss) == SS_ALL_OKAY)
+			;
+		BENCH_CLOBBER();
+	}
+}
+
+/* Every push shifts the whole stack. */
+static void bench_push_front(void *arg, uint64_t iters)
+{
+	struct ss *ss = arg;
+	size_t i;
+
+	while (iters-- > 0) {
+		for (i = 0; i < BENCH_STACK_LEN; i++)
+			ss_do_push_front(ss, &bench_data[i]);
+		ss_do_stack_clear(ss);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_rev(void *arg, uint64_t iters)
+{
+	struct ss *ss = arg;
+
+	while (iters-- > 0) {
+		ss_do_stack_rev(ss);
+		BENCH_CLOBBER();
+	}
+}
+
+static void bench_get_chkd(void *arg, uint64_t iters)
+{
+	struct ss *ss = arg;
+	size_t i;
+
+	while (iters-- > 0) {
+		for (i = 0; i < BENCH_STACK_LEN; i++)
+			BENCH_DO_NOT_OPTIMIZE(ss_do_get_elem_chkd(ss, i));
+	}
+}
+
+static void bench_report(const char *name, bench_fn fn, void *arg)
+{
+	struct bench_result res;
+
+	bench_do_run(name, fn, arg, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.2f ns per element\n", res.median_ns / BENCH_STACK_LEN);
+}
+
+int main(void)
+{
+	static struct ss ss;
+	size_t i;
+
+	ss_do_init(&ss);
+	bench_report("push_back + pop_back", bench_push_back, &ss);
+	bench_report("push_front + clear", bench_push_front, &ss);
+
+	for (i = 0; i < BENCH_STACK_LEN; i++)
+		ss_do_push_back(&ss, &bench_data[i]);
+	bench_report("stack_rev", bench_rev, &ss);
+	bench_report("get_elem_chkd", bench_get_chkd, &ss);
+
+	return (0);
+}
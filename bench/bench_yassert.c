@@ -0,0 +1,89 @@
+/* A tight loop with 4 assertions per element, at the YASSERT_LEVEL it's
+   built with, against the same loop without them. The level only
+   exists at compile time, so build it once per level; the size of the
+   loop is the one nm(1) reports for bench_checked_sum.
+   From the top directory:
+     for l in 0 1 2; do
+	     cc -O2 -DYASSERT_LEVEL=$l -o bench_yassert bench/bench_yassert.c &&
+		     ./bench_yassert && nm -S bench_yassert | grep _sum
+     done */
+
+#include <stddef.h>
+
+#define BENCH_IMPL
+#include "../yassert.h"
+#include "../bench.h"
+
+#ifndef BENCH_NELEMS
+# define BENCH_NELEMS    (4096)
+#endif
+
+static int bench_vals[BENCH_NELEMS];
+
+__attribute__((noinline))
+static long bench_checked_sum(const int *v, size_t n)
+{
+	long sum;
+	size_t i;
+
+	sum = 0;
+	for (i = 0; i < n; i++) {
+		yassert(v != NULL);
+		yassert(i < BENCH_NELEMS);
+		yassert(v[i] >= 0);
+		yassert(v[i] < 1000);
+		sum += v[i];
+	}
+	return (sum);
+}
+
+__attribute__((noinline))
+static long bench_plain_sum(const int *v, size_t n)
+{
+	long sum;
+	size_t i;
+
+	sum = 0;
+	for (i = 0; i < n; i++)
+		sum += v[i];
+	return (sum);
+}
+
+static void bench_checked(void *arg, uint64_t iters)
+{
+	(void)arg;
+	while (iters-- > 0)
+		BENCH_DO_NOT_OPTIMIZE(bench_checked_sum(bench_vals,
+							BENCH_NELEMS));
+}
+
+static void bench_plain(void *arg, uint64_t iters)
+{
+	(void)arg;
+	while (iters-- > 0)
+		BENCH_DO_NOT_OPTIMIZE(bench_plain_sum(bench_vals,
+						      BENCH_NELEMS));
+}
+
+int main(void)
+{
+	static const char *names[] = { "OFF", "CHEAP", "FULL" };
+	struct bench_result res;
+	char name[64];
+	size_t i;
+
+	for (i = 0; i < BENCH_NELEMS; i++)
+		bench_vals[i] = (int)(i % 1000);
+
+	snprintf(name, sizeof(name), "4 asserts per element (%s)",
+		 names[YASSERT_LEVEL]);
+	bench_do_run(name, bench_checked, NULL, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.3f ns/element\n", res.median_ns / BENCH_NELEMS);
+
+	bench_do_run("no asserts", bench_plain, NULL, &res);
+	bench_do_print(stdout, &res);
+	printf("  %.3f ns/element\n", res.median_ns / BENCH_NELEMS);
+
+	return (0);
+}
@@ -3,6 +3,44 @@
 #ifndef DLIST_H
 # define DLIST_H
 
+/* Trace the dlist_do_* functions, see trace.h. */
+#ifdef DLIST_TRACE
+# include "trace.h"
+# define DLIST_TRACE_SCOPE()    TRACE_SCOPE(__func__)
+#else
+# define DLIST_TRACE_SCOPE()
+#endif
+
+/* Account the nodes, see memacct.h. */
+#ifdef DLIST_ACCT
+# include "memacct.h"
+# define DLIST_ACCT_ALLOC(size)    memacct_do_alloc(MEMACCT_DLIST, size)
+# define DLIST_ACCT_FREE(size)     memacct_do_free(MEMACCT_DLIST, size)
+#else
+# define DLIST_ACCT_ALLOC(size)    do { } while (0)
+# define DLIST_ACCT_FREE(size)     do { } while (0)
+#endif
+
+/* Node allocator, each macro can be overridden on its own. With
+   DLIST_ARENA the nodes come from the thread's arena (see arena.h):
+   freeing a node does nothing, the list goes away with
+   arena_do_rewind() or arena_do_reset(). */
+#if defined (DLIST_ARENA)
+# include "arena.h"
+# ifndef DLIST_NODE_MALLOC
+#  define DLIST_NODE_MALLOC(size)    arena_do_self_alloc(size)
+# endif
+# ifndef DLIST_NODE_FREE
+#  define DLIST_NODE_FREE(node)      do { } while (0)
+# endif
+#endif
+#ifndef DLIST_NODE_MALLOC
+# define DLIST_NODE_MALLOC(size)    malloc(size)
+#endif
+#ifndef DLIST_NODE_FREE
+# define DLIST_NODE_FREE(node)      free(node)
+#endif
+
 struct dlist {
 	void *data;
 	struct dlist *prev;
@@ -87,9 +125,10 @@ static struct dlist *dlist_create_node(const void *data)
 {
 	struct dlist *node;
 
-	if ((node = malloc(sizeof(struct dlist))) == NULL)
+	if ((node = DLIST_NODE_MALLOC(sizeof(struct dlist))) == NULL)
 		return (NULL);
 
+	DLIST_ACCT_ALLOC(sizeof(struct dlist));
 	node->data = (void *)data;
 	node->prev = NULL;
 	node->next = NULL;
@@ -97,6 +136,12 @@ static struct dlist *dlist_create_node(const void *data)
 	return (node);
 }
 
+static void dlist_free_node(struct dlist *node)
+{
+	DLIST_ACCT_FREE(sizeof(struct dlist));
+	DLIST_NODE_FREE(node);
+}
+
 static struct dlist *dlist_swap_node(struct dlist **left,
 				     struct dlist **right)
 {
@@ -111,6 +156,7 @@ static struct dlist *dlist_swap_node(struct dlist **left,
 struct dlist *dlist_do_push_back(struct dlist *head, const void *data)
 {
 	struct dlist *nn, *t;
+	DLIST_TRACE_SCOPE();
 
 	nn = dlist_create_node(data);
 	if (nn == NULL)
@@ -131,6 +177,7 @@ struct dlist *dlist_do_push_back(struct dlist *head, const void *data)
 struct dlist *dlist_do_push_front(struct dlist *head, const void *data)
 {
 	struct dlist *nn;
+	DLIST_TRACE_SCOPE();
 
 	if ((nn = dlist_create_node(data)) == NULL)
 		return (NULL);
@@ -157,6 +204,7 @@ struct dlist *dlist_do_push_at(struct dlist *head, const void *data,
 			       size_t pos)
 {
 	struct dlist *t, *nn;
+	DLIST_TRACE_SCOPE();
 
 	if (pos == 0)
 		return (dlist_do_push_front(head, data));
@@ -182,11 +230,12 @@ struct dlist *dlist_do_push_at(struct dlist *head, const void *data,
 struct dlist *dlist_do_delete_first(struct dlist *head)
 {
 	struct dlist *t;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	head = head->next;
 
-	free(t);
+	dlist_free_node(t);
         head->prev = NULL;
 	return (head);
 }
@@ -194,6 +243,7 @@ struct dlist *dlist_do_delete_first(struct dlist *head)
 struct dlist *dlist_do_delete_last(struct dlist *head)
 {
 	struct dlist *t, *tmp;
+	DLIST_TRACE_SCOPE();
 
 	if (head->next == NULL)
 		return (dlist_do_delete_first(head));
@@ -203,13 +253,14 @@ struct dlist *dlist_do_delete_last(struct dlist *head)
 
 	tmp = t->next;
 	t->next = NULL;
-	free(tmp);
+	dlist_free_node(tmp);
         return (head);
 }
 
 struct dlist *dlist_do_delete_at(struct dlist *head, size_t pos)
 {
 	struct dlist *t, *tmp, *tt;
+	DLIST_TRACE_SCOPE();
 
 	if (pos == 0)
 	        return (dlist_do_delete_first(head));
@@ -224,7 +275,7 @@ struct dlist *dlist_do_delete_at(struct dlist *head, size_t pos)
 	/* Exact node. */
 	t->next->prev = t;
 
-	free(tmp);
+	dlist_free_node(tmp);
         return (head);
 }
 
@@ -232,6 +283,7 @@ struct dlist *dlist_do_delete_at(struct dlist *head, size_t pos)
 struct dlist *dlist_do_reverse(struct dlist *head)
 {
         struct dlist *t, *nn, *next;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	nn = NULL;
@@ -253,6 +305,7 @@ struct dlist *dlist_do_reverse(struct dlist *head)
 struct dlist *dlist_do_reverse2(struct dlist *head)
 {
 	struct dlist *t, *tmp;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	while (t != NULL) {
@@ -266,12 +319,13 @@ struct dlist *dlist_do_reverse2(struct dlist *head)
 struct dlist *dlist_do_remove_from_beg(struct dlist *head, size_t times)
 {
 	struct dlist *t, *tmp;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	while (times-- > 0) {
 		tmp = t;
 		t = t->next;
-		free(tmp);
+		dlist_free_node(tmp);
 		t->prev = NULL;
 	}
 	head = t;
@@ -284,6 +338,7 @@ struct dlist *dlist_do_remove_from_beg(struct dlist *head, size_t times)
 struct dlist *dlist_do_remove_from_end(struct dlist *head, size_t times)
 {
 	struct dlist *t, *tmp;
+	DLIST_TRACE_SCOPE();
 
 	while (times-- > 0) {
 		t = head;
@@ -292,7 +347,7 @@ struct dlist *dlist_do_remove_from_end(struct dlist *head, size_t times)
 
 		tmp = t->next;
 		t->next = t->next->next;
-		free(tmp);
+		dlist_free_node(tmp);
 	}
 
 	return (head);
@@ -301,18 +356,20 @@ struct dlist *dlist_do_remove_from_end(struct dlist *head, size_t times)
 void dlist_do_free(struct dlist *head)
 {
 	struct dlist *t, *free_node;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	while (t != NULL) {
 	        free_node = t;
 		t = t->next;
-		free(free_node);
+		dlist_free_node(free_node);
 	}
 }
 
 void dlist_do_free_data(struct dlist *head)
 {
         struct dlist *t, *free_node, *data;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	while (t != NULL) {
@@ -320,7 +377,7 @@ void dlist_do_free_data(struct dlist *head)
 		data = t->data;
 		t = t->next;
 		free(data);
-		free(free_node);
+		dlist_free_node(free_node);
 	}
 }
 
@@ -328,6 +385,7 @@ size_t dlist_do_count_nodes(struct dlist *head)
 {
 	struct dlist *t;
 	size_t count;
+	DLIST_TRACE_SCOPE();
 
 	t = head;
 	count = 0;
@@ -0,0 +1,425 @@
+/* Doubly linked list, C++ front-end of dlist.h. Elements are stored
+   in the nodes, nodes come from an allocator, and the iterators are
+   bidirectional iterators so <algorithm> works. Needs C++17. */
+
+#ifndef DLIST_HPP
+# define DLIST_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace ds {
+
+template <class T, class Alloc = std::allocator<T>>
+class dlist {
+	struct node;
+	using node_alloc = typename std::allocator_traits<Alloc>::
+		template rebind_alloc<node>;
+	using node_traits = std::allocator_traits<node_alloc>;
+	/* Whatever the allocator hands out, e.g. an offset pointer for
+	   nodes in shared memory. */
+	using node_ptr = typename node_traits::pointer;
+
+	struct node {
+		node_ptr prev;
+		node_ptr next;
+		T data;
+
+		template <class... Args>
+		explicit node(node_ptr p, node_ptr n, Args&&... args)
+			: prev(p), next(n), data(std::forward<Args>(args)...) {}
+	};
+
+public:
+	using value_type = T;
+	using allocator_type = Alloc;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = T &;
+	using const_reference = const T &;
+	using pointer = typename std::allocator_traits<Alloc>::pointer;
+	using const_pointer =
+		typename std::allocator_traits<Alloc>::const_pointer;
+
+	template <bool Const>
+	class basic_iterator {
+		friend class dlist;
+		node_ptr n_ = nullptr;
+		/* So that --end() finds the tail. */
+		const dlist *l_ = nullptr;
+
+		basic_iterator(node_ptr n, const dlist *l) noexcept
+			: n_(n), l_(l) {}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<Const, const T *, T *>;
+		using reference = std::conditional_t<Const, const T &, T &>;
+
+		basic_iterator() noexcept = default;
+		/* iterator to const_iterator. */
+		template <bool C = Const, class = std::enable_if_t<C>>
+		basic_iterator(const basic_iterator<false> &it) noexcept
+			: n_(it.n_), l_(it.l_) {}
+
+		reference operator*() const noexcept { return (n_->data); }
+		pointer operator->() const noexcept
+		{
+			return (std::addressof(n_->data));
+		}
+		basic_iterator &operator++() noexcept
+		{
+			n_ = n_->next;
+			return (*this);
+		}
+		basic_iterator operator++(int) noexcept
+		{
+			basic_iterator t = *this;
+
+			n_ = n_->next;
+			return (t);
+		}
+		basic_iterator &operator--() noexcept
+		{
+			n_ = n_ == nullptr ? l_->tail_ : n_->prev;
+			return (*this);
+		}
+		basic_iterator operator--(int) noexcept
+		{
+			basic_iterator t = *this;
+
+			--*this;
+			return (t);
+		}
+		friend bool operator==(basic_iterator a, basic_iterator b) noexcept
+		{
+			return (a.n_ == b.n_);
+		}
+		friend bool operator!=(basic_iterator a, basic_iterator b) noexcept
+		{
+			return (a.n_ != b.n_);
+		}
+	};
+
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	dlist() noexcept(noexcept(Alloc())) : dlist(Alloc()) {}
+	explicit dlist(const Alloc &a) noexcept : alloc_(a) {}
+	dlist(std::initializer_list<T> il, const Alloc &a = Alloc())
+		: dlist(il.begin(), il.end(), a) {}
+	template <class InputIt,
+		  class = typename std::iterator_traits<InputIt>::iterator_category>
+	dlist(InputIt first, InputIt last, const Alloc &a = Alloc()) : alloc_(a)
+	{
+		for (; first != last; ++first)
+			emplace_back(*first);
+	}
+	dlist(const dlist &o)
+		: alloc_(node_traits::select_on_container_copy_construction(
+				 o.alloc_))
+	{
+		for (const T &v : o)
+			emplace_back(v);
+	}
+	dlist(dlist &&o) noexcept
+		: head_(std::exchange(o.head_, nullptr)),
+		  tail_(std::exchange(o.tail_, nullptr)),
+		  size_(std::exchange(o.size_, 0)), alloc_(std::move(o.alloc_)) {}
+	~dlist() { clear(); }
+
+	dlist &operator=(const dlist &o)
+	{
+		if (this == &o)
+			return (*this);
+		clear();
+		if constexpr (node_traits::propagate_on_container_copy_assignment::value)
+			alloc_ = o.alloc_;
+		for (const T &v : o)
+			emplace_back(v);
+		return (*this);
+	}
+	dlist &operator=(dlist &&o) noexcept(
+		node_traits::propagate_on_container_move_assignment::value ||
+		node_traits::is_always_equal::value)
+	{
+		if (this == &o)
+			return (*this);
+		clear();
+		if constexpr (node_traits::propagate_on_container_move_assignment::value) {
+			alloc_ = std::move(o.alloc_);
+		} else if (!(alloc_ == o.alloc_)) {
+			/* Nodes can't change hands, move the elements. */
+			for (T &v : o)
+				emplace_back(std::move(v));
+			o.clear();
+			return (*this);
+		}
+		head_ = std::exchange(o.head_, nullptr);
+		tail_ = std::exchange(o.tail_, nullptr);
+		size_ = std::exchange(o.size_, 0);
+		return (*this);
+	}
+
+	allocator_type get_allocator() const { return (Alloc(alloc_)); }
+
+	iterator begin() noexcept { return (iterator(head_, this)); }
+	iterator end() noexcept { return (iterator(nullptr, this)); }
+	const_iterator begin() const noexcept
+	{
+		return (const_iterator(head_, this));
+	}
+	const_iterator end() const noexcept
+	{
+		return (const_iterator(nullptr, this));
+	}
+	const_iterator cbegin() const noexcept { return (begin()); }
+	const_iterator cend() const noexcept { return (end()); }
+	reverse_iterator rbegin() noexcept { return (reverse_iterator(end())); }
+	reverse_iterator rend() noexcept { return (reverse_iterator(begin())); }
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return (const_reverse_iterator(end()));
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return (const_reverse_iterator(begin()));
+	}
+
+	/* dlist_do_count_nodes(), in O(1). */
+	bool empty() const noexcept { return (head_ == nullptr); }
+	size_type size() const noexcept { return (size_); }
+
+	reference front() { return (head_->data); }
+	const_reference front() const { return (head_->data); }
+	reference back() { return (tail_->data); }
+	const_reference back() const { return (tail_->data); }
+
+	/* dlist_do_push_front(). */
+	void push_front(const T &v) { emplace_front(v); }
+	void push_front(T &&v) { emplace_front(std::move(v)); }
+	template <class... Args>
+	reference emplace_front(Args&&... args)
+	{
+		return (*emplace(begin(), std::forward<Args>(args)...));
+	}
+
+	/* dlist_do_push_back(), in O(1) as the tail is kept. */
+	void push_back(const T &v) { emplace_back(v); }
+	void push_back(T &&v) { emplace_back(std::move(v)); }
+	template <class... Args>
+	reference emplace_back(Args&&... args)
+	{
+		return (*emplace(end(), std::forward<Args>(args)...));
+	}
+
+	/* Insert before it. */
+	template <class... Args>
+	iterator emplace(const_iterator it, Args&&... args)
+	{
+		node_ptr next = it.n_;
+		node_ptr prev = next == nullptr ? tail_ : next->prev;
+		node_ptr n = make_node(prev, next, std::forward<Args>(args)...);
+
+		if (prev == nullptr)
+			head_ = n;
+		else
+			prev->next = n;
+		if (next == nullptr)
+			tail_ = n;
+		else
+			next->prev = n;
+		size_++;
+		return (iterator(n, this));
+	}
+	iterator insert(const_iterator it, const T &v)
+	{
+		return (emplace(it, v));
+	}
+	iterator insert(const_iterator it, T &&v)
+	{
+		return (emplace(it, std::move(v)));
+	}
+
+	/* dlist_do_push_at(), appends if pos is past the end. */
+	iterator insert_at(size_type pos, const T &v)
+	{
+		return (emplace(at_pos(pos), v));
+	}
+	iterator insert_at(size_type pos, T &&v)
+	{
+		return (emplace(at_pos(pos), std::move(v)));
+	}
+	template <class... Args>
+	iterator emplace_at(size_type pos, Args&&... args)
+	{
+		return (emplace(at_pos(pos), std::forward<Args>(args)...));
+	}
+
+	/* Remove the element at it, returns the one that followed. */
+	iterator erase(const_iterator it) noexcept
+	{
+		node_ptr n = it.n_;
+		node_ptr next = n->next;
+
+		if (n->prev == nullptr)
+			head_ = next;
+		else
+			n->prev->next = next;
+		if (next == nullptr)
+			tail_ = n->prev;
+		else
+			next->prev = n->prev;
+		size_--;
+		drop_node(n);
+		return (iterator(next, this));
+	}
+
+	/* dlist_do_delete_first(), dlist_do_delete_last(). */
+	void pop_front() noexcept
+	{
+		if (head_ != nullptr)
+			erase(begin());
+	}
+	void pop_back() noexcept
+	{
+		if (tail_ != nullptr)
+			erase(const_iterator(tail_, this));
+	}
+
+	/* dlist_do_remove_from_beg(), dlist_do_remove_from_end(). */
+	void pop_front_n(size_type n) noexcept
+	{
+		while (n-- > 0 && head_ != nullptr)
+			pop_front();
+	}
+	void pop_back_n(size_type n) noexcept
+	{
+		while (n-- > 0 && tail_ != nullptr)
+			pop_back();
+	}
+
+	/* dlist_do_delete_at(). */
+	void erase_at(size_type pos) noexcept
+	{
+		if (pos < size_)
+			erase(at_pos(pos));
+	}
+
+	/* dlist_do_reverse(). */
+	void reverse() noexcept
+	{
+		node_ptr t, next;
+
+		for (t = head_; t != nullptr; t = next) {
+			next = t->next;
+			t->next = t->prev;
+			t->prev = next;
+		}
+		std::swap(head_, tail_);
+	}
+
+	/* dlist_do_free(). */
+	void clear() noexcept
+	{
+		node_ptr t, x;
+
+		for (t = head_; t != nullptr; ) {
+			x = t;
+			t = t->next;
+			drop_node(x);
+		}
+		head_ = tail_ = nullptr;
+		size_ = 0;
+	}
+
+	void swap(dlist &o) noexcept
+	{
+		using std::swap;
+
+		swap(head_, o.head_);
+		swap(tail_, o.tail_);
+		swap(size_, o.size_);
+		if constexpr (node_traits::propagate_on_container_swap::value)
+			swap(alloc_, o.alloc_);
+	}
+
+	friend bool operator==(const dlist &a, const dlist &b)
+	{
+		const_iterator x, y;
+
+		if (a.size_ != b.size_)
+			return (false);
+		for (x = a.begin(), y = b.begin(); x != a.end(); ++x, ++y) {
+			if (!(*x == *y))
+				return (false);
+		}
+		return (true);
+	}
+	friend bool operator!=(const dlist &a, const dlist &b)
+	{
+		return (!(a == b));
+	}
+
+private:
+	/* Walk from the closest end. */
+	const_iterator at_pos(size_type pos) const noexcept
+	{
+		node_ptr t;
+
+		if (pos >= size_)
+			return (end());
+		if (pos < size_ / 2) {
+			for (t = head_; pos > 0; pos--)
+				t = t->next;
+		} else {
+			for (t = tail_, pos = size_ - 1 - pos; pos > 0; pos--)
+				t = t->prev;
+		}
+		return (const_iterator(t, this));
+	}
+
+	template <class... Args>
+	node_ptr make_node(node_ptr prev, node_ptr next, Args&&... args)
+	{
+		node_ptr n = node_traits::allocate(alloc_, 1);
+
+		try {
+			node_traits::construct(alloc_, std::addressof(*n), prev, next,
+					       std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(alloc_, n, 1);
+			throw;
+		}
+		return (n);
+	}
+
+	void drop_node(node_ptr n) noexcept
+	{
+		node_traits::destroy(alloc_, std::addressof(*n));
+		node_traits::deallocate(alloc_, n, 1);
+	}
+
+	node_ptr head_ = nullptr;
+	node_ptr tail_ = nullptr;
+	size_type size_ = 0;
+	node_alloc alloc_;
+};
+
+template <class T, class Alloc>
+void swap(dlist<T, Alloc> &a, dlist<T, Alloc> &b) noexcept
+{
+	a.swap(b);
+}
+
+} /* namespace ds */
+
+#endif /* DLIST_HPP */
@@ -0,0 +1,382 @@
+/* Chained hash map. Buckets are singly linked chains of pooled
+   nodes, each node caches the hash of its key. Growing the table is
+   incremental: while a resize is in progress both tables are live, and
+   every operation moves a few buckets to the new one, so no single
+   insert pays for the whole resize. With 4M pointer keys, the slowest
+   insert took 130-146 ms when resizing all at once, and no longer
+   stands out of the scheduling noise (1-8 ms) this way, see
+   bench/bench_hmap.c. */
+
+#ifndef HMAP_H
+# define HMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Initial number of buckets, a power of two. */
+#ifndef HMAP_INIT_SIZE
+# define HMAP_INIT_SIZE      (16)
+#endif
+
+/* Non-empty buckets moved per operation while resizing. */
+#ifndef HMAP_REHASH_STEP
+# define HMAP_REHASH_STEP    (4)
+#endif
+
+/* Nodes allocated at once by the pool. */
+#ifndef HMAP_POOL_CHUNK
+# define HMAP_POOL_CHUNK     (256)
+#endif
+
+/* Constants. Used as return codes. */
+#define HMAP_ALL_OKAY        (0)
+#define HMAP_ALLOC_FAILED    (-2)
+#define HMAP_NOT_FOUND       (-4)
+
+typedef uint64_t (*hmap_hash_fn)(const void *key);
+/* Non-zero if both keys are equal. */
+typedef int (*hmap_eq_fn)(const void *a, const void *b);
+
+/* Chain node, the key and its hash follow the link. */
+struct hmap_node {
+	void *data;
+	struct hmap_node *next;
+	const void *key;
+	uint64_t hash;
+};
+
+struct hmap_table {
+	struct hmap_node **b;
+	/* Number of buckets, a power of two. */
+	size_t cap;
+	size_t n;
+};
+
+struct hmap_chunk {
+	struct hmap_chunk *next;
+	struct hmap_node nodes[HMAP_POOL_CHUNK];
+};
+
+struct hmap {
+	/* t[1] is only allocated while resizing. */
+	struct hmap_table t[2];
+	/* Next bucket of t[0] to move. */
+	size_t rehash_idx;
+	hmap_hash_fn hash;
+	hmap_eq_fn eq;
+	struct hmap_chunk *chunks;
+	struct hmap_node *free_nodes;
+};
+
+/* Initialize an empty map, nothing is allocated yet. */
+extern void hmap_do_init(struct hmap *m, hmap_hash_fn hash, hmap_eq_fn eq);
+/* Insert key, or replace its value. */
+extern int hmap_do_put(struct hmap *m, const void *key, void *data);
+/* Node of key, NULL if there's none. */
+extern struct hmap_node *hmap_do_find(struct hmap *m, const void *key);
+/* Value of key, NULL if there's none. */
+extern void *hmap_do_get(struct hmap *m, const void *key);
+/* Remove key, its value is stored in data if not NULL. */
+extern int hmap_do_remove(struct hmap *m, const void *key, void **data);
+/* Number of keys. */
+extern size_t hmap_do_count(const struct hmap *m);
+/* Call fn on every node. */
+extern void hmap_do_foreach(struct hmap *m,
+			    void (*fn)(struct hmap_node *, void *), void *arg);
+/* Free the tables and the nodes, not the keys or values. */
+extern void hmap_do_free(struct hmap *m);
+
+/* Hashes and comparisons of common keys. */
+extern uint64_t hmap_do_hash_str(const void *key);
+extern int hmap_do_eq_str(const void *a, const void *b);
+/* The pointer itself is the key, for integers cast to pointers. */
+extern uint64_t hmap_do_hash_ptr(const void *key);
+extern int hmap_do_eq_ptr(const void *a, const void *b);
+
+#define HMAP_DO_PUT(m, key, data)    hmap_do_put(m, key, data)
+#define HMAP_DO_GET(m, key)          hmap_do_get(m, key)
+#define HMAP_DO_REMOVE(m, key)       hmap_do_remove(m, key, NULL)
+#define HMAP_DO_COUNT(m)             hmap_do_count(m)
+#define HMAP_DO_FREE(m)              hmap_do_free(m)
+
+#ifdef HMAP_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+
+void hmap_do_init(struct hmap *m, hmap_hash_fn hash, hmap_eq_fn eq)
+{
+	memset(m, '\0', sizeof(struct hmap));
+	m->hash = hash;
+	m->eq = eq;
+}
+
+static struct hmap_node *hmap_node_get(struct hmap *m)
+{
+	struct hmap_chunk *c;
+	struct hmap_node *n;
+	size_t i;
+
+	if (m->free_nodes == NULL) {
+		if ((c = malloc(sizeof(struct hmap_chunk))) == NULL)
+			return (NULL);
+		c->next = m->chunks;
+		m->chunks = c;
+		for (i = HMAP_POOL_CHUNK; i-- > 0; ) {
+			c->nodes[i].next = m->free_nodes;
+			m->free_nodes = &c->nodes[i];
+		}
+	}
+
+	n = m->free_nodes;
+	m->free_nodes = n->next;
+	return (n);
+}
+
+static void hmap_node_put(struct hmap *m, struct hmap_node *n)
+{
+	n->next = m->free_nodes;
+	m->free_nodes = n;
+}
+
+static int hmap_is_rehashing(const struct hmap *m)
+{
+	return (m->t[1].b != NULL);
+}
+
+/* Move up to HMAP_REHASH_STEP non-empty buckets to the new table. */
+static void hmap_rehash_step(struct hmap *m)
+{
+	struct hmap_node *n, *next, **dst;
+	size_t moved, visits;
+
+	/* Bound the empty buckets skipped as well. */
+	visits = HMAP_REHASH_STEP * 10;
+	for (moved = 0; moved < HMAP_REHASH_STEP && visits > 0; visits--) {
+		if (m->rehash_idx == m->t[0].cap)
+			break;
+		n = m->t[0].b[m->rehash_idx];
+		m->t[0].b[m->rehash_idx++] = NULL;
+		if (n == NULL)
+			continue;
+
+		/* The hash is cached, keys aren't looked at. */
+		for (; n != NULL; n = next) {
+			next = n->next;
+			dst = &m->t[1].b[n->hash & (m->t[1].cap - 1)];
+			n->next = *dst;
+			*dst = n;
+			m->t[0].n--;
+			m->t[1].n++;
+		}
+		moved++;
+	}
+
+	if (m->rehash_idx == m->t[0].cap) {
+		free(m->t[0].b);
+		m->t[0] = m->t[1];
+		memset(&m->t[1], '\0', sizeof(struct hmap_table));
+		m->rehash_idx = 0;
+	}
+}
+
+/* Make room for one more key. */
+static int hmap_reserve(struct hmap *m)
+{
+	struct hmap_node **b;
+	size_t cap;
+
+	if (hmap_is_rehashing(m)) {
+		hmap_rehash_step(m);
+		return (HMAP_ALL_OKAY);
+	}
+
+	if (m->t[0].b == NULL) {
+		if ((b = calloc(HMAP_INIT_SIZE, sizeof(*b))) == NULL)
+			return (HMAP_ALLOC_FAILED);
+		m->t[0].b = b;
+		m->t[0].cap = HMAP_INIT_SIZE;
+		return (HMAP_ALL_OKAY);
+	}
+
+	/* Load factor of 1. */
+	if (m->t[0].n < m->t[0].cap)
+		return (HMAP_ALL_OKAY);
+
+	cap = m->t[0].cap * 2;
+	if ((b = calloc(cap, sizeof(*b))) == NULL) {
+		/* Keep going with longer chains. */
+		return (HMAP_ALL_OKAY);
+	}
+	m->t[1].b = b;
+	m->t[1].cap = cap;
+	m->t[1].n = 0;
+	m->rehash_idx = 0;
+	hmap_rehash_step(m);
+	return (HMAP_ALL_OKAY);
+}
+
+/* Link pointing to the node of key, NULL if there's none. */
+static struct hmap_node **hmap_lookup(struct hmap *m, const void *key,
+				      uint64_t h, struct hmap_table **tp)
+{
+	struct hmap_node **p;
+	int i;
+
+	for (i = hmap_is_rehashing(m); i >= 0; i--) {
+		if (m->t[i].b == NULL)
+			continue;
+		for (p = &m->t[i].b[h & (m->t[i].cap - 1)]; *p != NULL;
+		     p = &(*p)->next) {
+			if ((*p)->hash == h && m->eq((*p)->key, key)) {
+				*tp = &m->t[i];
+				return (p);
+			}
+		}
+	}
+
+	return (NULL);
+}
+
+int hmap_do_put(struct hmap *m, const void *key, void *data)
+{
+	struct hmap_node **p, *n;
+	struct hmap_table *t;
+	uint64_t h;
+	int r;
+
+	h = m->hash(key);
+	if ((p = hmap_lookup(m, key, h, &t)) != NULL) {
+		(*p)->data = data;
+		return (HMAP_ALL_OKAY);
+	}
+
+	/* Only a new key needs room, replacing one never resizes. */
+	if ((r = hmap_reserve(m)) != HMAP_ALL_OKAY)
+		return (r);
+	if ((n = hmap_node_get(m)) == NULL)
+		return (HMAP_ALLOC_FAILED);
+	n->data = data;
+	n->key = key;
+	n->hash = h;
+
+	/* New keys go to the new table while resizing. */
+	t = &m->t[hmap_is_rehashing(m)];
+	p = &t->b[h & (t->cap - 1)];
+	n->next = *p;
+	*p = n;
+	t->n++;
+	return (HMAP_ALL_OKAY);
+}
+
+struct hmap_node *hmap_do_find(struct hmap *m, const void *key)
+{
+	struct hmap_node **p;
+	struct hmap_table *t;
+
+	if (hmap_is_rehashing(m))
+		hmap_rehash_step(m);
+	p = hmap_lookup(m, key, m->hash(key), &t);
+	return (p == NULL ? NULL : *p);
+}
+
+void *hmap_do_get(struct hmap *m, const void *key)
+{
+	struct hmap_node *n;
+
+	n = hmap_do_find(m, key);
+	return (n == NULL ? NULL : n->data);
+}
+
+int hmap_do_remove(struct hmap *m, const void *key, void **data)
+{
+	struct hmap_node **p, *n;
+	struct hmap_table *t;
+
+	if (hmap_is_rehashing(m))
+		hmap_rehash_step(m);
+	if ((p = hmap_lookup(m, key, m->hash(key), &t)) == NULL)
+		return (HMAP_NOT_FOUND);
+
+	n = *p;
+	*p = n->next;
+	t->n--;
+	if (data != NULL)
+		*data = n->data;
+	hmap_node_put(m, n);
+	return (HMAP_ALL_OKAY);
+}
+
+size_t hmap_do_count(const struct hmap *m)
+{
+	return (m->t[0].n + m->t[1].n);
+}
+
+void hmap_do_foreach(struct hmap *m, void (*fn)(struct hmap_node *, void *),
+		     void *arg)
+{
+	struct hmap_node *n, *next;
+	size_t i;
+	int j;
+
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < m->t[j].cap; i++) {
+			for (n = m->t[j].b[i]; n != NULL; n = next) {
+				next = n->next;
+				fn(n, arg);
+			}
+		}
+	}
+}
+
+void hmap_do_free(struct hmap *m)
+{
+	struct hmap_chunk *c, *next;
+
+	for (c = m->chunks; c != NULL; c = next) {
+		next = c->next;
+		free(c);
+	}
+	free(m->t[0].b);
+	free(m->t[1].b);
+	hmap_do_init(m, m->hash, m->eq);
+}
+
+/* FNV-1a. */
+uint64_t hmap_do_hash_str(const void *key)
+{
+	const unsigned char *s;
+	uint64_t h;
+
+	h = 0xcbf29ce484222325ULL;
+	for (s = key; *s != '\0'; s++) {
+		h ^= *s;
+		h *= 0x100000001b3ULL;
+	}
+	return (h);
+}
+
+int hmap_do_eq_str(const void *a, const void *b)
+{
+	return (strcmp(a, b) == 0);
+}
+
+/* Finalizer of splitmix64, so that the low bits are usable. */
+uint64_t hmap_do_hash_ptr(const void *key)
+{
+	uint64_t h;
+
+	h = (uint64_t)(uintptr_t)key;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	return (h ^ (h >> 31));
+}
+
+int hmap_do_eq_ptr(const void *a, const void *b)
+{
+	return (a == b);
+}
+
+#endif /* HMAP_IMPL */
+
+#endif /* HMAP_H */
@@ -0,0 +1,290 @@
+/* cgroup v2 memory accounting. Unlike /proc/meminfo, these are
+   the numbers that apply inside a container. */
+
+#ifndef CGROUP_H
+# define CGROUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "procfs.h"
+
+#ifndef CGROUP2_ROOT_PATH
+# define CGROUP2_ROOT_PATH         "/sys/fs/cgroup"
+#endif
+#ifndef PROC_SELF_CGROUP_PATH
+# define PROC_SELF_CGROUP_PATH     "/proc/self/cgroup"
+#endif
+
+/* Maximum length of a cgroup directory path. */
+#ifndef CGROUP_PATH_MAX
+# define CGROUP_PATH_MAX           (4096)
+#endif
+
+/* Constants. Used as return codes, the first ones share their
+   values with PROC_KV_*. */
+#define CGROUP_ALL_OKAY            (0)
+#define CGROUP_OPEN_FAILED         (-1)
+#define CGROUP_ALLOC_FAILED        (-2)
+#define CGROUP_READ_FAILED         (-3)
+#define CGROUP_NOT_FOUND           (-4)
+#define CGROUP_PATH_TOO_LONG       (-5)
+
+/* Value of memory.max and memory.high when set to "max". */
+#define CGROUP_MEM_UNLIMITED       UINT64_MAX
+
+/* memory.stat, in bytes or events. */
+struct cgroup_memory_stat {
+	uint64_t anon;
+	uint64_t file;
+	uint64_t kernel;
+	uint64_t kernel_stack;
+	uint64_t pagetables;
+	uint64_t sock;
+	uint64_t shmem;
+	uint64_t file_mapped;
+	uint64_t file_dirty;
+	uint64_t file_writeback;
+	uint64_t swapcached;
+	uint64_t anon_thp;
+	uint64_t inactive_anon;
+	uint64_t active_anon;
+	uint64_t inactive_file;
+	uint64_t active_file;
+	uint64_t unevictable;
+	uint64_t slab_reclaimable;
+	uint64_t slab_unreclaimable;
+	uint64_t slab;
+	uint64_t workingset_refault_anon;
+	uint64_t workingset_refault_file;
+	uint64_t pgfault;
+	uint64_t pgmajfault;
+	uint64_t pgscan;
+	uint64_t pgsteal;
+};
+
+/* memory.events. */
+struct cgroup_memory_events {
+	uint64_t low;
+	uint64_t high;
+	uint64_t max;
+	uint64_t oom;
+	uint64_t oom_kill;
+	uint64_t oom_group_kill;
+};
+
+struct cgroup_memory {
+	uint64_t current;
+	uint64_t max;
+	uint64_t high;
+	struct cgroup_memory_stat stat;
+	struct cgroup_memory_events events;
+};
+
+/* Find the cgroup directory of the calling process, below root
+   (CGROUP2_ROOT_PATH if NULL). */
+extern int cgroup_do_discover(struct proc_buf *pb, const char *root,
+			      char *dir, size_t size);
+/* Read all memory.* files of a cgroup directory. For the root cgroup,
+   which has no memory.current, current is summed up from memory.stat
+   and there are no limits. */
+extern int cgroup_do_read_memory(struct proc_buf *pb, const char *dir,
+				 struct cgroup_memory *cm);
+/* Bytes that can still be charged before hitting memory.high or
+   memory.max, counting inactive file pages as reclaimable.
+   CGROUP_MEM_UNLIMITED if there's no limit. */
+extern uint64_t cgroup_do_mem_avail(const struct cgroup_memory *cm);
+
+#ifdef CGROUP_IMPL
+
+#include <string.h>
+
+static const struct proc_kv_field cgroup_memory_stat_kv[] = {
+	PROC_KV_FIELD("anon", struct cgroup_memory_stat, anon),
+	PROC_KV_FIELD("file", struct cgroup_memory_stat, file),
+	PROC_KV_FIELD("kernel", struct cgroup_memory_stat, kernel),
+	PROC_KV_FIELD("kernel_stack", struct cgroup_memory_stat, kernel_stack),
+	PROC_KV_FIELD("pagetables", struct cgroup_memory_stat, pagetables),
+	PROC_KV_FIELD("sock", struct cgroup_memory_stat, sock),
+	PROC_KV_FIELD("shmem", struct cgroup_memory_stat, shmem),
+	PROC_KV_FIELD("file_mapped", struct cgroup_memory_stat, file_mapped),
+	PROC_KV_FIELD("file_dirty", struct cgroup_memory_stat, file_dirty),
+	PROC_KV_FIELD("file_writeback", struct cgroup_memory_stat,
+		      file_writeback),
+	PROC_KV_FIELD("swapcached", struct cgroup_memory_stat, swapcached),
+	PROC_KV_FIELD("anon_thp", struct cgroup_memory_stat, anon_thp),
+	PROC_KV_FIELD("inactive_anon", struct cgroup_memory_stat,
+		      inactive_anon),
+	PROC_KV_FIELD("active_anon", struct cgroup_memory_stat, active_anon),
+	PROC_KV_FIELD("inactive_file", struct cgroup_memory_stat,
+		      inactive_file),
+	PROC_KV_FIELD("active_file", struct cgroup_memory_stat, active_file),
+	PROC_KV_FIELD("unevictable", struct cgroup_memory_stat, unevictable),
+	PROC_KV_FIELD("slab_reclaimable", struct cgroup_memory_stat,
+		      slab_reclaimable),
+	PROC_KV_FIELD("slab_unreclaimable", struct cgroup_memory_stat,
+		      slab_unreclaimable),
+	PROC_KV_FIELD("slab", struct cgroup_memory_stat, slab),
+	PROC_KV_FIELD("workingset_refault_anon", struct cgroup_memory_stat,
+		      workingset_refault_anon),
+	PROC_KV_FIELD("workingset_refault_file", struct cgroup_memory_stat,
+		      workingset_refault_file),
+	PROC_KV_FIELD("pgfault", struct cgroup_memory_stat, pgfault),
+	PROC_KV_FIELD("pgmajfault", struct cgroup_memory_stat, pgmajfault),
+	PROC_KV_FIELD("pgscan", struct cgroup_memory_stat, pgscan),
+	PROC_KV_FIELD("pgsteal", struct cgroup_memory_stat, pgsteal),
+};
+
+static const struct proc_kv_field cgroup_memory_events_kv[] = {
+	PROC_KV_FIELD("low", struct cgroup_memory_events, low),
+	PROC_KV_FIELD("high", struct cgroup_memory_events, high),
+	PROC_KV_FIELD("max", struct cgroup_memory_events, max),
+	PROC_KV_FIELD("oom", struct cgroup_memory_events, oom),
+	PROC_KV_FIELD("oom_kill", struct cgroup_memory_events, oom_kill),
+	PROC_KV_FIELD("oom_group_kill", struct cgroup_memory_events,
+		      oom_group_kill),
+};
+
+static int cgroup_join(char *dst, size_t size, const char *dir,
+		       const char *name)
+{
+	size_t dlen, nlen;
+
+	dlen = strlen(dir);
+	nlen = strlen(name);
+	if (dlen + nlen + 2 > size)
+		return (CGROUP_PATH_TOO_LONG);
+
+	memcpy(dst, dir, dlen);
+	dst[dlen] = '/';
+	memcpy(dst + dlen + 1, name, nlen + 1);
+	return (CGROUP_ALL_OKAY);
+}
+
+/* Single value files, such as memory.current or memory.max. */
+static int cgroup_read_u64(struct proc_buf *pb, const char *dir,
+			   const char *name, uint64_t *dst)
+{
+	int r;
+	const char *k;
+	char path[CGROUP_PATH_MAX];
+
+	if ((r = cgroup_join(path, sizeof(path), dir, name)) != CGROUP_ALL_OKAY)
+		return (r);
+	if ((r = proc_do_buf_read(pb, path)) != PROC_KV_ALL_OKAY)
+		return (r);
+
+	if (strncmp(pb->data, "max", 3) == 0) {
+		*dst = CGROUP_MEM_UNLIMITED;
+		return (CGROUP_ALL_OKAY);
+	}
+
+	*dst = 0;
+	for (k = pb->data; *k >= '0' && *k <= '9'; k++)
+		*dst = *dst * 10 + (uint64_t)(*k - '0');
+	return (CGROUP_ALL_OKAY);
+}
+
+int cgroup_do_discover(struct proc_buf *pb, const char *root,
+		       char *dir, size_t size)
+{
+	int r;
+	char *line, *nl;
+	size_t rlen, plen;
+
+	if (root == NULL)
+		root = CGROUP2_ROOT_PATH;
+	if ((r = proc_do_buf_read(pb, PROC_SELF_CGROUP_PATH)) != PROC_KV_ALL_OKAY)
+		return (r);
+
+	/* The unified hierarchy is the "0::<path>" line, the others
+	   are cgroup v1 controllers. */
+	for (line = pb->data; ; line = nl + 1) {
+		if ((nl = strchr(line, '\n')) == NULL)
+			nl = line + strlen(line);
+		if (strncmp(line, "0::", 3) == 0)
+			break;
+		if (*nl == '\0')
+			return (CGROUP_NOT_FOUND);
+	}
+
+	line += 3;
+	rlen = strlen(root);
+	plen = (size_t)(nl - line);
+	/* Strip the trailing slash of "/", so the root cgroup maps to
+	   root itself. */
+	if (plen == 1 && *line == '/')
+		plen = 0;
+	if (rlen + plen + 1 > size)
+		return (CGROUP_PATH_TOO_LONG);
+
+	memcpy(dir, root, rlen);
+	memcpy(dir + rlen, line, plen);
+	dir[rlen + plen] = '\0';
+	return (CGROUP_ALL_OKAY);
+}
+
+/* What memory.current would be, for the root cgroup. "kernel" (5.18)
+   covers the stacks, page tables and slabs. */
+static uint64_t cgroup_stat_charged(const struct cgroup_memory_stat *st)
+{
+	uint64_t kernel;
+
+	kernel = st->kernel;
+	if (kernel == 0)
+		kernel = st->kernel_stack + st->pagetables + st->slab;
+	return (st->anon + st->file + kernel + st->sock);
+}
+
+int cgroup_do_read_memory(struct proc_buf *pb, const char *dir,
+			  struct cgroup_memory *cm)
+{
+	int r, rstat;
+	char path[CGROUP_PATH_MAX];
+
+	memset(cm, '\0', sizeof(struct cgroup_memory));
+	if ((r = cgroup_join(path, sizeof(path), dir, "memory.stat")) !=
+	    CGROUP_ALL_OKAY)
+		return (r);
+	rstat = proc_do_read_kv(pb, path, cgroup_memory_stat_kv,
+				PROC_KV_NFIELDS(cgroup_memory_stat_kv),
+				&cm->stat, sizeof(struct cgroup_memory_stat));
+
+	/* The root cgroup has neither memory.current, nor a limit. */
+	if ((r = cgroup_read_u64(pb, dir, "memory.current",
+				 &cm->current)) != CGROUP_ALL_OKAY) {
+		if (rstat != PROC_KV_ALL_OKAY)
+			return (r);
+		cm->current = cgroup_stat_charged(&cm->stat);
+	}
+	if (cgroup_read_u64(pb, dir, "memory.max", &cm->max) != CGROUP_ALL_OKAY)
+		cm->max = CGROUP_MEM_UNLIMITED;
+	if (cgroup_read_u64(pb, dir, "memory.high", &cm->high) != CGROUP_ALL_OKAY)
+		cm->high = CGROUP_MEM_UNLIMITED;
+
+	if (cgroup_join(path, sizeof(path), dir, "memory.events") == CGROUP_ALL_OKAY)
+		proc_do_read_kv(pb, path, cgroup_memory_events_kv,
+				PROC_KV_NFIELDS(cgroup_memory_events_kv),
+				&cm->events, sizeof(struct cgroup_memory_events));
+
+	return (CGROUP_ALL_OKAY);
+}
+
+uint64_t cgroup_do_mem_avail(const struct cgroup_memory *cm)
+{
+	uint64_t limit, avail;
+
+	limit = cm->max < cm->high ? cm->max : cm->high;
+	if (limit == CGROUP_MEM_UNLIMITED)
+		return (CGROUP_MEM_UNLIMITED);
+
+	avail = limit > cm->current ? limit - cm->current : 0;
+	/* Inactive page cache is dropped before reclaim hurts. */
+	if (avail + cm->stat.inactive_file > limit)
+		return (limit);
+	return (avail + cm->stat.inactive_file);
+}
+
+#endif /* CGROUP_IMPL */
+
+#endif /* CGROUP_H */
@@ -0,0 +1,427 @@
+/* Fixed size object pool backed by huge pages, for lists big enough
+   to thrash the dTLB. Slabs come from, in order of preference:
+     - hugetlbfs pages (mmap(MAP_HUGETLB)), if /proc/meminfo reports
+       enough free ones;
+     - transparent huge pages (madvise(MADV_HUGEPAGE));
+     - normal pages.
+   To back a list with it:
+     #define SLL_NODE_MALLOC(size)    hpool_do_alloc(&pool)
+     #define SLL_NODE_FREE(node)      hpool_do_free(&pool, node)
+     #include "sll.h"
+   bench/bench_hpool.c walks a list from each kind of slab. */
+
+#ifndef HPOOL_H
+# define HPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "procfs.h"
+
+/* Slab size when no huge page size is known. */
+#ifndef HPOOL_SLAB_SIZE
+# define HPOOL_SLAB_SIZE          (2 * 1024 * 1024)
+#endif
+
+/* Objects up to a cache line are aligned on their size rounded up to
+   a power of two, bigger ones on a cache line, so that none of them
+   straddles more lines than it has to. */
+#ifndef HPOOL_CACHE_LINE
+# define HPOOL_CACHE_LINE         (64)
+#endif
+
+/* Constants. Used as return codes, the first ones share their
+   values with PROC_KV_*. */
+#define HPOOL_ALL_OKAY            (0)
+#define HPOOL_ALLOC_FAILED        (-2)
+#define HPOOL_BAD_SIZE            (-4)
+
+/* Flags of hpool_do_init(). */
+#define HPOOL_NO_HUGETLB          (1 << 0)
+#define HPOOL_NO_THP              (1 << 1)
+
+/* Backing of a slab. */
+#define HPOOL_NORMAL              (0)
+#define HPOOL_HUGETLB             (1)
+#define HPOOL_THP                 (2)
+
+struct hpool_slab {
+	void *base;
+	size_t size;
+	int kind;
+	/* Objects of this slab handed out and not freed. */
+	size_t live;
+	/* Given back by hpool_do_trim(), carved again from the start
+	   when it's reused. */
+	int trimmed;
+	struct hpool_slab *next;
+};
+
+struct hpool {
+	size_t obj_size;
+	/* In bytes, a multiple of the huge page size. */
+	size_t slab_size;
+	/* Next kind of slab to try. */
+	int kind;
+	int flags;
+	/* Freed objects, linked through their first word. */
+	void *free_list;
+	char *cur;
+	char *end;
+	/* Oldest first, cur_slab is the one being carved. */
+	struct hpool_slab *slabs;
+	struct hpool_slab *cur_slab;
+	/* The same slabs sorted by address, to find the one of an
+	   object. */
+	struct hpool_slab **index;
+	size_t nindex;
+	size_t index_cap;
+	/* Number of slabs of each kind. */
+	size_t nslabs[3];
+	/* Objects handed out and not freed. */
+	size_t live;
+};
+
+/* Initialize a pool of obj_size objects. pmi is used to tell whether
+   hugetlbfs pages are available, it's read from PROC_MEMINFO_PATH if
+   NULL. Nothing is mapped yet. */
+extern int hpool_do_init(struct hpool *hp, size_t obj_size, int flags,
+			 const struct proc_meminfo *pmi);
+/* Allocate an object, NULL if out of memory. */
+extern void *hpool_do_alloc(struct hpool *hp);
+/* Give an object back to the pool. */
+extern void hpool_do_free(struct hpool *hp, void *obj);
+/* Give about fraction (0, 1] of the idle slabs, those without a live
+   object, back with madvise(MADV_DONTNEED). They stay mapped and are
+   reused before new ones are mapped. Returns the number of bytes
+   released, see memtrim.h. */
+extern size_t hpool_do_trim(struct hpool *hp, double fraction);
+/* Unmap every slab. */
+extern void hpool_do_destroy(struct hpool *hp);
+/* Name of a slab kind. */
+extern const char *hpool_do_kind_name(int kind);
+
+#ifdef HPOOL_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGETLB
+# define MAP_HUGETLB              0x40000
+#endif
+
+int hpool_do_init(struct hpool *hp, size_t obj_size, int flags,
+		  const struct proc_meminfo *pmi)
+{
+	struct proc_meminfo mi;
+	struct proc_buf pb;
+	size_t huge, align;
+
+	if (obj_size == 0)
+		return (HPOOL_BAD_SIZE);
+
+	memset(hp, '\0', sizeof(struct hpool));
+	/* Room for the free list link. */
+	if (obj_size < sizeof(void *))
+		obj_size = sizeof(void *);
+	for (align = sizeof(void *); align < obj_size &&
+		     align < HPOOL_CACHE_LINE; align *= 2)
+		;
+	hp->obj_size = (obj_size + align - 1) & ~(align - 1);
+	hp->flags = flags;
+
+	if (pmi == NULL) {
+		memset(&pb, '\0', sizeof(pb));
+		if (proc_do_read_meminfo(&pb, &mi) != PROC_KV_ALL_OKAY)
+			memset(&mi, '\0', sizeof(mi));
+		proc_do_buf_free(&pb);
+		pmi = &mi;
+	}
+
+	/* Hugepagesize is in kB. */
+	huge = (size_t)pmi->huge_page_size * 1024;
+	hp->slab_size = huge != 0 ? huge : HPOOL_SLAB_SIZE;
+	while (hp->slab_size < hp->obj_size)
+		hp->slab_size *= 2;
+
+	if (!(flags & HPOOL_NO_HUGETLB) && huge != 0 &&
+	    pmi->huge_pages_free * huge >= hp->slab_size)
+		hp->kind = HPOOL_HUGETLB;
+	else if (!(flags & HPOOL_NO_THP))
+		hp->kind = HPOOL_THP;
+	else
+		hp->kind = HPOOL_NORMAL;
+
+	return (HPOOL_ALL_OKAY);
+}
+
+/* Map size bytes aligned on size, so that THP can back them. */
+static void *hpool_map_aligned(size_t size)
+{
+	char *p, *a;
+	size_t head;
+
+	p = mmap(NULL, size * 2, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return (NULL);
+
+	a = (char *)(((uintptr_t)p + size - 1) & ~((uintptr_t)size - 1));
+	head = (size_t)(a - p);
+	if (head > 0)
+		munmap(p, head);
+	munmap(a + size, size - head);
+	return (a);
+}
+
+/* Position of the slab holding p in the index, or of the first slab
+   above p. */
+static size_t hpool_index_find(const struct hpool *hp, const void *p)
+{
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = hp->nindex;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if ((const char *)p < (const char *)hp->index[mid]->base)
+			hi = mid;
+		else if ((const char *)p >= (const char *)hp->index[mid]->base +
+			 hp->index[mid]->size)
+			lo = mid + 1;
+		else
+			return (mid);
+	}
+
+	return (lo);
+}
+
+/* Slab of an object that came from the pool. */
+static struct hpool_slab *hpool_slab_of(const struct hpool *hp,
+					const void *obj)
+{
+	return (hp->index[hpool_index_find(hp, obj)]);
+}
+
+static struct hpool_slab *hpool_add_slab(struct hpool *hp)
+{
+	struct hpool_slab *s, *last, **index;
+	size_t i, cap;
+	void *p;
+	int kind;
+
+	if (hp->nindex == hp->index_cap) {
+		cap = hp->index_cap == 0 ? 8 : hp->index_cap * 2;
+		if ((index = realloc(hp->index, cap * sizeof(*index))) == NULL)
+			return (NULL);
+		hp->index = index;
+		hp->index_cap = cap;
+	}
+	if ((s = malloc(sizeof(struct hpool_slab))) == NULL)
+		return (NULL);
+
+	p = NULL;
+	kind = hp->kind;
+	/* The hugetlbfs pages may be gone since init, or taken by
+	   someone else: fall back for good. */
+	if (kind == HPOOL_HUGETLB) {
+		p = mmap(NULL, hp->slab_size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p == MAP_FAILED) {
+			p = NULL;
+			hp->kind = hp->flags & HPOOL_NO_THP ? HPOOL_NORMAL :
+				HPOOL_THP;
+			kind = hp->kind;
+		}
+	}
+	/* The aligned mapping needs twice the address space, and may
+	   fail where a plain one doesn't: this slab gets normal pages,
+	   the next one tries again. */
+	if (p == NULL && kind == HPOOL_THP) {
+		if ((p = hpool_map_aligned(hp->slab_size)) == NULL) {
+			kind = HPOOL_NORMAL;
+		} else if (madvise(p, hp->slab_size, MADV_HUGEPAGE) == -1) {
+			hp->kind = HPOOL_NORMAL;
+			kind = hp->kind;
+		}
+	}
+	if (p == NULL && kind == HPOOL_NORMAL) {
+		p = mmap(NULL, hp->slab_size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			p = NULL;
+	}
+	if (p == NULL) {
+		free(s);
+		return (NULL);
+	}
+
+	s->base = p;
+	s->size = hp->slab_size;
+	/* madvise() failing turned this one into a normal slab. */
+	s->kind = kind;
+	s->live = 0;
+	s->trimmed = 0;
+	s->next = NULL;
+	if (hp->slabs == NULL) {
+		hp->slabs = s;
+	} else {
+		for (last = hp->slabs; last->next != NULL; last = last->next)
+			;
+		last->next = s;
+	}
+
+	i = hpool_index_find(hp, p);
+	memmove(&hp->index[i + 1], &hp->index[i],
+		(hp->nindex - i) * sizeof(*hp->index));
+	hp->index[i] = s;
+	hp->nindex++;
+	hp->nslabs[s->kind]++;
+	return (s);
+}
+
+/* Move to the next slab, trimmed ones are reused first. */
+static int hpool_next_slab(struct hpool *hp)
+{
+	struct hpool_slab *s;
+
+	for (s = hp->slabs; s != NULL && !s->trimmed; s = s->next)
+		;
+	if (s == NULL && (s = hpool_add_slab(hp)) == NULL)
+		return (HPOOL_ALLOC_FAILED);
+
+	s->trimmed = 0;
+	hp->cur_slab = s;
+	hp->cur = s->base;
+	hp->end = hp->cur + s->size;
+	return (HPOOL_ALL_OKAY);
+}
+
+void *hpool_do_alloc(struct hpool *hp)
+{
+	void *p;
+
+	if ((p = hp->free_list) != NULL) {
+		hp->free_list = *(void **)p;
+		hpool_slab_of(hp, p)->live++;
+		hp->live++;
+		return (p);
+	}
+
+	if ((size_t)(hp->end - hp->cur) < hp->obj_size &&
+	    hpool_next_slab(hp) != HPOOL_ALL_OKAY)
+		return (NULL);
+	p = hp->cur;
+	hp->cur += hp->obj_size;
+	hp->cur_slab->live++;
+	hp->live++;
+	return (p);
+}
+
+void hpool_do_free(struct hpool *hp, void *obj)
+{
+	*(void **)obj = hp->free_list;
+	hp->free_list = obj;
+	hpool_slab_of(hp, obj)->live--;
+	hp->live--;
+}
+
+/* Idle slab that hpool_do_trim() can give back. */
+#define HPOOL_SLAB_IDLE(s)    ((s)->live == 0 && !(s)->trimmed)
+
+size_t hpool_do_trim(struct hpool *hp, double fraction)
+{
+	struct hpool_slab *s;
+	size_t idle, want, released, stop, i;
+	void **pp;
+
+	if (fraction <= 0)
+		return (0);
+	if (fraction > 1)
+		fraction = 1;
+
+	idle = 0;
+	for (i = 0; i < hp->nindex; i++) {
+		if (HPOOL_SLAB_IDLE(hp->index[i]))
+			idle++;
+	}
+	/* Rounded up, so that a small fraction still trims a slab. */
+	want = (size_t)(fraction * (double)idle);
+	if ((double)want < fraction * (double)idle)
+		want++;
+	if (want == 0)
+		return (0);
+
+	/* The highest idle slabs go, so that the objects stay packed
+	   at the bottom. */
+	for (stop = hp->nindex; stop > 0 && want > 0; stop--) {
+		if (HPOOL_SLAB_IDLE(hp->index[stop - 1]))
+			want--;
+	}
+
+	/* Drop their objects from the free list before the pages
+	   holding the links are zeroed. */
+	for (pp = &hp->free_list; *pp != NULL; ) {
+		i = hpool_index_find(hp, *pp);
+		if (i >= stop && HPOOL_SLAB_IDLE(hp->index[i]))
+			*pp = *(void **)*pp;
+		else
+			pp = *pp;
+	}
+
+	released = 0;
+	for (i = stop; i < hp->nindex; i++) {
+		s = hp->index[i];
+		if (!HPOOL_SLAB_IDLE(s))
+			continue;
+		s->trimmed = 1;
+		if (s == hp->cur_slab) {
+			hp->cur_slab = NULL;
+			hp->cur = NULL;
+			hp->end = NULL;
+		}
+		if (madvise(s->base, s->size, MADV_DONTNEED) == 0)
+			released += s->size;
+	}
+
+	return (released);
+}
+
+void hpool_do_destroy(struct hpool *hp)
+{
+	struct hpool_slab *s, *next;
+
+	for (s = hp->slabs; s != NULL; s = next) {
+		next = s->next;
+		munmap(s->base, s->size);
+		free(s);
+	}
+	free(hp->index);
+	hp->index = NULL;
+	hp->nindex = 0;
+	hp->index_cap = 0;
+	hp->slabs = NULL;
+	hp->cur_slab = NULL;
+	hp->free_list = NULL;
+	hp->live = 0;
+	hp->cur = NULL;
+	hp->end = NULL;
+	memset(hp->nslabs, '\0', sizeof(hp->nslabs));
+}
+
+const char *hpool_do_kind_name(int kind)
+{
+	switch (kind) {
+	case HPOOL_HUGETLB:
+		return ("hugetlb");
+	case HPOOL_THP:
+		return ("thp");
+	default:
+		return ("normal");
+	}
+}
+
+#endif /* HPOOL_IMPL */
+
+#endif /* HPOOL_H */
@@ -0,0 +1,301 @@
+/* Serialize struct proc_meminfo as Prometheus exposition text, or
+   as a compact binary snapshot delta-encoded against the previous
+   one. Both write into a caller buffer, without allocating. */
+
+#ifndef MEMEXPORT_H
+# define MEMEXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "memrate.h"
+
+/* Metric names are "<prefix><Key>[_bytes]", as node_exporter does. */
+#ifndef MEMEXPORT_METRIC_PREFIX
+# define MEMEXPORT_METRIC_PREFIX    "node_memory_"
+#endif
+
+/* Constants. Used as return codes. */
+#define MEMEXPORT_NO_SPACE          (-1)
+#define MEMEXPORT_BAD_FORMAT        (-2)
+
+/* Binary snapshot header. */
+#define MEMEXPORT_MAGIC             (0x4d)
+#define MEMEXPORT_VERSION           (1)
+#define MEMEXPORT_FLAG_DELTA        (0x01)
+
+/* Largest binary snapshot: header, field count and 10 bytes per
+   varint. */
+#define MEMEXPORT_BINARY_MAX					\
+	(3 + 2 + PROC_MEMINFO_NFIELDS * 10)
+
+/* Write one "name value" line per field. Returns the number of
+   bytes written (not NUL-terminated), or MEMEXPORT_NO_SPACE. */
+extern ssize_t memexport_do_text(const struct proc_meminfo *pmi,
+				 char *buf, size_t size);
+/* Write a binary snapshot, delta-encoded against prev if it's not
+   NULL. Returns the number of bytes written, or MEMEXPORT_NO_SPACE. */
+extern ssize_t memexport_do_binary(const struct proc_meminfo *pmi,
+				   const struct proc_meminfo *prev,
+				   uint8_t *buf, size_t size);
+/* Decode a binary snapshot, prev must be the snapshot it was
+   encoded against. Returns the number of bytes consumed. */
+extern ssize_t memexport_do_decode_binary(const uint8_t *buf, size_t len,
+					  const struct proc_meminfo *prev,
+					  struct proc_meminfo *pmi);
+
+#ifdef MEMEXPORT_IMPL
+
+#include <string.h>
+
+struct memexport_metric {
+	const char *name;
+	uint8_t len;
+	/* Multiplier from the /proc/meminfo unit to the exported
+	   one, 1024 for "kB" fields. */
+	uint16_t scale;
+};
+
+#define MEMEXPORT_METRIC(member, key, scale)				\
+	[PROC_MEMINFO_IDX(member)] = {					\
+		MEMEXPORT_METRIC_PREFIX key " ",			\
+		sizeof(MEMEXPORT_METRIC_PREFIX key " ") - 1, scale	\
+	}
+#define MEMEXPORT_KB(member, key)					\
+	MEMEXPORT_METRIC(member, key "_bytes", 1024)
+#define MEMEXPORT_COUNT(member, key)					\
+	MEMEXPORT_METRIC(member, key, 1)
+
+/* Names include the separating space, so a line is one memcpy()
+   of the name and the digits. */
+static const struct memexport_metric memexport_metrics[] = {
+	MEMEXPORT_KB(mem_total, "MemTotal"),
+	MEMEXPORT_KB(mem_free, "MemFree"),
+	MEMEXPORT_KB(mem_avail, "MemAvailable"),
+	MEMEXPORT_KB(buffers, "Buffers"),
+	MEMEXPORT_KB(cached, "Cached"),
+	MEMEXPORT_KB(swap_cached, "SwapCached"),
+	MEMEXPORT_KB(active, "Active"),
+	MEMEXPORT_KB(inactive, "Inactive"),
+	MEMEXPORT_KB(active_anon, "Active_anon"),
+	MEMEXPORT_KB(inactive_anon, "Inactive_anon"),
+	MEMEXPORT_KB(active_file, "Active_file"),
+	MEMEXPORT_KB(inactive_file, "Inactive_file"),
+	MEMEXPORT_KB(unevictable, "Unevictable"),
+	MEMEXPORT_KB(mlocked, "Mlocked"),
+	MEMEXPORT_KB(high_total, "HighTotal"),
+	MEMEXPORT_KB(high_free, "HighFree"),
+	MEMEXPORT_KB(low_total, "LowTotal"),
+	MEMEXPORT_KB(low_free, "LowFree"),
+	MEMEXPORT_KB(mmap_copy, "MmapCopy"),
+	MEMEXPORT_KB(swap_total, "SwapTotal"),
+	MEMEXPORT_KB(swap_free, "SwapFree"),
+	MEMEXPORT_KB(zswap, "Zswap"),
+	MEMEXPORT_KB(zswapped, "Zswapped"),
+	MEMEXPORT_KB(dirty, "Dirty"),
+	MEMEXPORT_KB(write_back, "Writeback"),
+	MEMEXPORT_KB(anon_pages, "AnonPages"),
+	MEMEXPORT_KB(mapped, "Mapped"),
+	MEMEXPORT_KB(shmem, "Shmem"),
+	MEMEXPORT_KB(k_reclaimable, "KReclaimable"),
+	MEMEXPORT_KB(slab, "Slab"),
+	MEMEXPORT_KB(s_reclaimable, "SReclaimable"),
+	MEMEXPORT_KB(s_unreclaim, "SUnreclaim"),
+	MEMEXPORT_KB(kernel_stack, "KernelStack"),
+	MEMEXPORT_KB(page_tables, "PageTables"),
+	MEMEXPORT_KB(quick_lists, "QuickLists"),
+	MEMEXPORT_KB(sec_page_tables, "SecPageTables"),
+	MEMEXPORT_KB(nfs_unstable, "NFS_Unstable"),
+	MEMEXPORT_KB(bounce, "Bounce"),
+	MEMEXPORT_KB(write_back_tmp, "WritebackTmp"),
+	MEMEXPORT_KB(commit_limit, "CommitLimit"),
+	MEMEXPORT_KB(committed_as, "Committed_AS"),
+	MEMEXPORT_KB(vm_alloc_total, "VmallocTotal"),
+	MEMEXPORT_KB(vm_alloc_used, "VmallocUsed"),
+	MEMEXPORT_KB(vm_alloc_chunk, "VmallocChunk"),
+	MEMEXPORT_KB(percpu, "Percpu"),
+	MEMEXPORT_KB(hardware_corrupted, "HardwareCorrupted"),
+	MEMEXPORT_KB(lazy_free, "LazyFree"),
+	MEMEXPORT_KB(anon_huge_pages, "AnonHugePages"),
+	MEMEXPORT_KB(shmem_huge_pages, "ShmemHugePages"),
+	MEMEXPORT_KB(shmempmd_mapped, "ShmemPmdMapped"),
+	MEMEXPORT_KB(file_huge_pages, "FileHugePages"),
+	MEMEXPORT_KB(filepmd_mapped, "FilePmdMapped"),
+	MEMEXPORT_KB(cma_total, "CmaTotal"),
+	MEMEXPORT_KB(cma_free, "CmaFree"),
+	MEMEXPORT_COUNT(huge_pages_total, "HugePages_Total"),
+	MEMEXPORT_COUNT(huge_pages_free, "HugePages_Free"),
+	MEMEXPORT_COUNT(huge_pages_rsvd, "HugePages_Rsvd"),
+	MEMEXPORT_COUNT(huge_pages_surp, "HugePages_Surp"),
+	MEMEXPORT_KB(huge_page_size, "Hugepagesize"),
+	MEMEXPORT_KB(hugetlb, "Hugetlb"),
+#if defined (__i386__) || defined (__x86_64__)
+	MEMEXPORT_KB(direct_map_4k, "DirectMap4k"),
+	MEMEXPORT_KB(direct_map_4M, "DirectMap4M"),
+	MEMEXPORT_KB(direct_map_2M, "DirectMap2M"),
+	MEMEXPORT_KB(direct_map_1G, "DirectMap1G"),
+#endif /* __i386__, __x86_64__ */
+};
+
+/* Every field of struct proc_meminfo must have a name. The size
+   check only catches a missing last field, holes are left NULL by
+   the designated initializers: they're skipped by the text output
+   and caught by tests/test_memexport.c. */
+typedef char memexport_metrics_check[
+	PROC_KV_NFIELDS(memexport_metrics) == PROC_MEMINFO_NFIELDS ? 1 : -1];
+
+static const char memexport_digits[] =
+	"00010203040506070809101112131415161718192021222324252627282930"
+	"31323334353637383940414243444546474849505152535455565758596061"
+	"62636465666768697071727374757677787980818283848586878889909192"
+	"93949596979899";
+
+/* Convert an integer to decimal, two digits at a time. Returns the
+   number of digits, dst must hold at least 20 bytes. */
+static size_t memexport_u64_to_dec(uint64_t v, char *dst)
+{
+	char tmp[20], *p;
+	size_t n, i;
+
+	p = tmp + sizeof(tmp);
+	while (v >= 100) {
+		i = (size_t)(v % 100) * 2;
+		v /= 100;
+		*--p = memexport_digits[i + 1];
+		*--p = memexport_digits[i];
+	}
+	if (v >= 10) {
+		i = (size_t)v * 2;
+		*--p = memexport_digits[i + 1];
+		*--p = memexport_digits[i];
+	} else {
+		*--p = (char)('0' + v);
+	}
+
+	n = (size_t)(tmp + sizeof(tmp) - p);
+	memcpy(dst, p, n);
+	return (n);
+}
+
+ssize_t memexport_do_text(const struct proc_meminfo *pmi, char *buf,
+			  size_t size)
+{
+	size_t i, off;
+	const uint64_t *v;
+	const struct memexport_metric *m;
+
+	v = (const uint64_t *)pmi;
+	off = 0;
+	for (i = 0; i < PROC_MEMINFO_NFIELDS; i++) {
+		m = &memexport_metrics[i];
+		if (m->name == NULL)
+			continue;
+		/* Name, 20 digits and the newline. */
+		if (size - off < (size_t)m->len + 21)
+			return (MEMEXPORT_NO_SPACE);
+
+		memcpy(buf + off, m->name, m->len);
+		off += m->len;
+		off += memexport_u64_to_dec(v[i] * m->scale, buf + off);
+		buf[off++] = '\n';
+	}
+
+	return ((ssize_t)off);
+}
+
+static size_t memexport_put_varint(uint8_t *dst, uint64_t v)
+{
+	size_t n;
+
+	for (n = 0; v >= 0x80; n++, v >>= 7)
+		dst[n] = (uint8_t)(v | 0x80);
+	dst[n++] = (uint8_t)v;
+	return (n);
+}
+
+static size_t memexport_get_varint(const uint8_t *src, size_t len,
+				   uint64_t *v)
+{
+	size_t n;
+	unsigned int shift;
+
+	*v = 0;
+	for (n = 0, shift = 0; n < len && shift < 64; n++, shift += 7) {
+		*v |= (uint64_t)(src[n] & 0x7f) << shift;
+		if (!(src[n] & 0x80))
+			return (n + 1);
+	}
+
+	return (0);
+}
+
+ssize_t memexport_do_binary(const struct proc_meminfo *pmi,
+			    const struct proc_meminfo *prev,
+			    uint8_t *buf, size_t size)
+{
+	size_t i, off;
+	int64_t d;
+	const uint64_t *v, *p;
+
+	if (size < MEMEXPORT_BINARY_MAX)
+		return (MEMEXPORT_NO_SPACE);
+
+	v = (const uint64_t *)pmi;
+	p = (const uint64_t *)prev;
+	buf[0] = MEMEXPORT_MAGIC;
+	buf[1] = MEMEXPORT_VERSION;
+	buf[2] = prev != NULL ? MEMEXPORT_FLAG_DELTA : 0;
+	off = 3;
+	off += memexport_put_varint(buf + off, PROC_MEMINFO_NFIELDS);
+
+	for (i = 0; i < PROC_MEMINFO_NFIELDS; i++) {
+		if (p == NULL) {
+			off += memexport_put_varint(buf + off, v[i]);
+			continue;
+		}
+		/* Zigzag, so that small negative deltas stay short. */
+		d = (int64_t)(v[i] - p[i]);
+		off += memexport_put_varint(buf + off, ((uint64_t)d << 1) ^
+					    (uint64_t)(d >> 63));
+	}
+
+	return ((ssize_t)off);
+}
+
+ssize_t memexport_do_decode_binary(const uint8_t *buf, size_t len,
+				   const struct proc_meminfo *prev,
+				   struct proc_meminfo *pmi)
+{
+	size_t i, off, n;
+	uint64_t nfields, z;
+	uint64_t *v;
+	const uint64_t *p;
+
+	if (len < 4 || buf[0] != MEMEXPORT_MAGIC ||
+	    buf[1] != MEMEXPORT_VERSION)
+		return (MEMEXPORT_BAD_FORMAT);
+	if ((buf[2] & MEMEXPORT_FLAG_DELTA) && prev == NULL)
+		return (MEMEXPORT_BAD_FORMAT);
+
+	off = 3;
+	if ((n = memexport_get_varint(buf + off, len - off, &nfields)) == 0 ||
+	    nfields != PROC_MEMINFO_NFIELDS)
+		return (MEMEXPORT_BAD_FORMAT);
+	off += n;
+
+	v = (uint64_t *)pmi;
+	p = (buf[2] & MEMEXPORT_FLAG_DELTA) ? (const uint64_t *)prev : NULL;
+	for (i = 0; i < PROC_MEMINFO_NFIELDS; i++) {
+		if ((n = memexport_get_varint(buf + off, len - off, &z)) == 0)
+			return (MEMEXPORT_BAD_FORMAT);
+		off += n;
+		v[i] = p == NULL ? z : p[i] + ((z >> 1) ^ (0 - (z & 1)));
+	}
+
+	return ((ssize_t)off);
+}
+
+#endif /* MEMEXPORT_IMPL */
+
+#endif /* MEMEXPORT_H */
@@ -1,6 +1,7 @@
 #ifndef MEMINFO_H
 # define MEMINFO_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /* Structure containing all the members that might exists
@@ -79,7 +80,76 @@ struct proc_meminfo {
 # define PROC_MEMINFO_PATH    "/proc/meminfo"
 #endif
 
+/* Initial size of a read buffer, grows by doubling. */
+#ifndef PROC_BUF_INIT_SIZE
+# define PROC_BUF_INIT_SIZE    (4096)
+#endif
+
+/* Trace the proc_do_* functions, see trace.h. */
+#ifdef PROC_TRACE
+# include "../trace.h"
+# define PROC_TRACE_SCOPE()    TRACE_SCOPE(__func__)
+#else
+# define PROC_TRACE_SCOPE()
+#endif
+
 /* Constants. Used as return codes. */
+#define PROC_KV_ALL_OKAY           (0)
+#define PROC_KV_OPEN_FAILED        (-1)
+#define PROC_KV_ALLOC_FAILED       (-2)
+#define PROC_KV_READ_FAILED        (-3)
+
+/* Read buffer, reused across reads so that a sample doesn't have
+   to allocate. Always NUL-terminated. */
+struct proc_buf {
+	char *data;
+	size_t len;
+	size_t cap;
+};
+
+/* Describes where the value(s) of a key are stored. Every value
+   is an uint64_t, nvals consecutive values are parsed for keys
+   like "cpu" in /proc/stat. */
+struct proc_kv_field {
+	const char *key;
+	uint16_t klen;
+	uint16_t nvals;
+	uint32_t off;
+};
+
+#define PROC_KV_FIELD(key, type, member)				\
+	{ key, sizeof(key) - 1, 1, (uint32_t)offsetof(type, member) }
+#define PROC_KV_FIELDN(key, type, member, n)				\
+	{ key, sizeof(key) - 1, n, (uint32_t)offsetof(type, member) }
+#define PROC_KV_NFIELDS(tbl)    (sizeof(tbl) / sizeof(*(tbl)))
+
+/* Read a whole file into the buffer. */
+extern int proc_do_buf_read(struct proc_buf *pb, const char *path);
+/* Read an already opened file again, from offset 0. */
+extern int proc_do_buf_pread(struct proc_buf *pb, int fd);
+/* Free the buffer. */
+extern void proc_do_buf_free(struct proc_buf *pb);
+/* Parse a single line, returns 1 if the key was known. */
+extern int proc_do_parse_kv_line(const char *line, const char *end,
+				 const struct proc_kv_field *tbl,
+				 size_t n, size_t *hint, void *dst);
+/* Parse the whole buffer, returns the number of known keys. */
+extern size_t proc_do_parse_kv(const char *src, size_t len,
+			       const struct proc_kv_field *tbl,
+			       size_t n, void *dst);
+/* Read and parse a file into a zeroed structure. */
+extern int proc_do_read_kv(struct proc_buf *pb, const char *path,
+			   const struct proc_kv_field *tbl, size_t n,
+			   void *dst, size_t dst_size);
+
+/* Read PROC_MEMINFO_PATH into a zeroed structure. */
+extern int proc_do_read_meminfo(struct proc_buf *pb,
+				struct proc_meminfo *pmi);
+
+/* Constants of the functions below. Used as return codes, the first
+   ones share their values with PROC_KV_*: PROC_KV_READ_FAILED, whose
+   value is taken by PROC_MEMINFO_NO_KEY, is mapped to
+   PROC_MEMINFO_READ_FAILED. */
 #ifndef PROC_MEMINFO_ALL_OKAY
 # define PROC_MEMINFO_ALL_OKAY         (0)
 #endif
@@ -92,6 +162,17 @@ struct proc_meminfo {
 #ifndef PROC_MEMINFO_NO_KEY
 # define PROC_MEMINFO_NO_KEY           (-3)
 #endif
+#ifndef PROC_MEMINFO_READ_FAILED
+# define PROC_MEMINFO_READ_FAILED      (-4)
+#endif
+
+/* Read the whole /proc/meminfo file into a newly allocated buffer,
+   to be freed with free(3). */
+extern int proc_do_init_meminfo(struct proc_meminfo *pmi, char **p);
+/* Parse the value of a single key, with or without its colon. */
+extern int proc_do_get_kv(const char *src, const char *key, uint64_t *dst);
+/* Parse every known key into the structure. */
+extern void proc_do_collect_all(struct proc_meminfo *pmi, const char *src);
 
 #ifdef MEMINFO_IMPL
 
@@ -99,150 +180,268 @@ struct proc_meminfo {
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <ctype.h>
-	
-/* Compiler extension to check for overflow. */
-#if defined (__GNUC__)
-# define gcc_mul_ovf_check(x, y, r)		\
-	__builtin_mul_overflow(x, y, &r)	
-#else
-/* For compilers that doesn't implements GNU extensions.
-   e.g. TinyCC */
-# define gcc_mul_ovf_check(x, y, r)     (0)
-#endif
 
-int proc_do_init_meminfo(struct proc_meminfo *pmi, char **p)
+/* Keys are listed in the order the kernel prints them, so that the
+   lookup hint almost always hits on the first try. */
+static const struct proc_kv_field proc_meminfo_kv[] = {
+	PROC_KV_FIELD("MemTotal", struct proc_meminfo, mem_total),
+	PROC_KV_FIELD("MemFree", struct proc_meminfo, mem_free),
+	PROC_KV_FIELD("MemAvailable", struct proc_meminfo, mem_avail),
+	PROC_KV_FIELD("Buffers", struct proc_meminfo, buffers),
+	PROC_KV_FIELD("Cached", struct proc_meminfo, cached),
+	PROC_KV_FIELD("SwapCached", struct proc_meminfo, swap_cached),
+	PROC_KV_FIELD("Active", struct proc_meminfo, active),
+	PROC_KV_FIELD("Inactive", struct proc_meminfo, inactive),
+	PROC_KV_FIELD("Active(anon)", struct proc_meminfo, active_anon),
+	PROC_KV_FIELD("Inactive(anon)", struct proc_meminfo, inactive_anon),
+	PROC_KV_FIELD("Active(file)", struct proc_meminfo, active_file),
+	PROC_KV_FIELD("Inactive(file)", struct proc_meminfo, inactive_file),
+	PROC_KV_FIELD("Unevictable", struct proc_meminfo, unevictable),
+	PROC_KV_FIELD("Mlocked", struct proc_meminfo, mlocked),
+	PROC_KV_FIELD("HighTotal", struct proc_meminfo, high_total),
+	PROC_KV_FIELD("HighFree", struct proc_meminfo, high_free),
+	PROC_KV_FIELD("LowTotal", struct proc_meminfo, low_total),
+	PROC_KV_FIELD("LowFree", struct proc_meminfo, low_free),
+	PROC_KV_FIELD("MmapCopy", struct proc_meminfo, mmap_copy),
+	PROC_KV_FIELD("SwapTotal", struct proc_meminfo, swap_total),
+	PROC_KV_FIELD("SwapFree", struct proc_meminfo, swap_free),
+	PROC_KV_FIELD("Zswap", struct proc_meminfo, zswap),
+	PROC_KV_FIELD("Zswapped", struct proc_meminfo, zswapped),
+	PROC_KV_FIELD("Dirty", struct proc_meminfo, dirty),
+	PROC_KV_FIELD("Writeback", struct proc_meminfo, write_back),
+	PROC_KV_FIELD("AnonPages", struct proc_meminfo, anon_pages),
+	PROC_KV_FIELD("Mapped", struct proc_meminfo, mapped),
+	PROC_KV_FIELD("Shmem", struct proc_meminfo, shmem),
+	PROC_KV_FIELD("KReclaimable", struct proc_meminfo, k_reclaimable),
+	PROC_KV_FIELD("Slab", struct proc_meminfo, slab),
+	PROC_KV_FIELD("SReclaimable", struct proc_meminfo, s_reclaimable),
+	PROC_KV_FIELD("SUnreclaim", struct proc_meminfo, s_unreclaim),
+	PROC_KV_FIELD("KernelStack", struct proc_meminfo, kernel_stack),
+	PROC_KV_FIELD("PageTables", struct proc_meminfo, page_tables),
+	PROC_KV_FIELD("QuickLists", struct proc_meminfo, quick_lists),
+	PROC_KV_FIELD("SecPageTables", struct proc_meminfo, sec_page_tables),
+	PROC_KV_FIELD("NFS_Unstable", struct proc_meminfo, nfs_unstable),
+	PROC_KV_FIELD("Bounce", struct proc_meminfo, bounce),
+	PROC_KV_FIELD("WritebackTmp", struct proc_meminfo, write_back_tmp),
+	PROC_KV_FIELD("CommitLimit", struct proc_meminfo, commit_limit),
+	PROC_KV_FIELD("Committed_AS", struct proc_meminfo, committed_as),
+	PROC_KV_FIELD("VmallocTotal", struct proc_meminfo, vm_alloc_total),
+	PROC_KV_FIELD("VmallocUsed", struct proc_meminfo, vm_alloc_used),
+	PROC_KV_FIELD("VmallocChunk", struct proc_meminfo, vm_alloc_chunk),
+	PROC_KV_FIELD("Percpu", struct proc_meminfo, percpu),
+	PROC_KV_FIELD("HardwareCorrupted", struct proc_meminfo,
+		      hardware_corrupted),
+	PROC_KV_FIELD("AnonHugePages", struct proc_meminfo, anon_huge_pages),
+	PROC_KV_FIELD("ShmemHugePages", struct proc_meminfo, shmem_huge_pages),
+	PROC_KV_FIELD("ShmemPmdMapped", struct proc_meminfo, shmempmd_mapped),
+	PROC_KV_FIELD("FileHugePages", struct proc_meminfo, file_huge_pages),
+	PROC_KV_FIELD("FilePmdMapped", struct proc_meminfo, filepmd_mapped),
+	PROC_KV_FIELD("CmaTotal", struct proc_meminfo, cma_total),
+	PROC_KV_FIELD("CmaFree", struct proc_meminfo, cma_free),
+	PROC_KV_FIELD("LazyFree", struct proc_meminfo, lazy_free),
+	PROC_KV_FIELD("HugePages_Total", struct proc_meminfo, huge_pages_total),
+	PROC_KV_FIELD("HugePages_Free", struct proc_meminfo, huge_pages_free),
+	PROC_KV_FIELD("HugePages_Rsvd", struct proc_meminfo, huge_pages_rsvd),
+	PROC_KV_FIELD("HugePages_Surp", struct proc_meminfo, huge_pages_surp),
+	PROC_KV_FIELD("Hugepagesize", struct proc_meminfo, huge_page_size),
+	PROC_KV_FIELD("Hugetlb", struct proc_meminfo, hugetlb),
+#if defined (__i386__) || defined (__x86_64__)
+	PROC_KV_FIELD("DirectMap4k", struct proc_meminfo, direct_map_4k),
+	PROC_KV_FIELD("DirectMap4M", struct proc_meminfo, direct_map_4M),
+	PROC_KV_FIELD("DirectMap2M", struct proc_meminfo, direct_map_2M),
+	PROC_KV_FIELD("DirectMap1G", struct proc_meminfo, direct_map_1G),
+#endif /* __i386__, __x86_64__ */
+};
+
+static int proc_buf_grow(struct proc_buf *pb)
 {
-	int fd;
-	char buf[1024];
-	ssize_t nbytes_read;
-	size_t total_read;
+	char *p;
+	size_t ncap;
 
-	/* Initialize the struct members with 0. */
-	memset(pmi, '\0', sizeof(struct proc_meminfo));
+	ncap = pb->cap == 0 ? PROC_BUF_INIT_SIZE : pb->cap * 2;
+	if ((p = realloc(pb->data, ncap)) == NULL)
+		return (PROC_KV_ALLOC_FAILED);
 
-	if ((fd = open(PROC_MEMINFO_PATH, O_RDONLY)) == -1)
-	        return (PROC_MEMINFO_OPEN_FAILED);
+	pb->data = p;
+	pb->cap = ncap;
+	return (PROC_KV_ALL_OKAY);
+}
 
-	memset(buf, '\0', sizeof(buf));
-        if ((*p = calloc(1, sizeof(char))) == NULL)
-		return (PROC_MEMINFO_ALLOC_FAILED);
+int proc_do_buf_pread(struct proc_buf *pb, int fd)
+{
+	ssize_t nbytes_read;
+	PROC_TRACE_SCOPE();
 
-        total_read = 0;
-	while ((nbytes_read = read(fd, buf, sizeof(buf) - 1)) > 0) {
-		if ((*p = realloc(*p, total_read + nbytes_read + 1)) == NULL)
-		        return (PROC_MEMINFO_ALLOC_FAILED);
+	pb->len = 0;
+	for (;;) {
+		/* Keep a byte for the NUL terminator. */
+		if (pb->cap - pb->len < 2 && proc_buf_grow(pb) != PROC_KV_ALL_OKAY)
+			return (PROC_KV_ALLOC_FAILED);
 
-	        memcpy(*p + total_read, buf, nbytes_read);
-		total_read += nbytes_read;
+		nbytes_read = pread(fd, pb->data + pb->len,
+				    pb->cap - pb->len - 1, (off_t)pb->len);
+		if (nbytes_read == -1)
+			return (PROC_KV_READ_FAILED);
+		if (nbytes_read == 0)
+			break;
+		pb->len += (size_t)nbytes_read;
 	}
 
-        if (*(*p + total_read - 1) == '\n')
-		*(*p + total_read - 1) = '\0';
-	else if (*(*p + total_read) == '\n')
-		*(*p + total_read) = '\0';
+	pb->data[pb->len] = '\0';
+	return (PROC_KV_ALL_OKAY);
+}
 
-	return (PROC_MEMINFO_ALL_OKAY);
+int proc_do_buf_read(struct proc_buf *pb, const char *path)
+{
+	int fd, r;
+	PROC_TRACE_SCOPE();
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return (PROC_KV_OPEN_FAILED);
+
+	r = proc_do_buf_pread(pb, fd);
+	close(fd);
+	return (r);
 }
 
-int proc_do_get_kv(const char *src, const char *key, uint64_t *dst)
+void proc_do_buf_free(struct proc_buf *pb)
 {
-	char *k;
-	unsigned int r;
+	PROC_TRACE_SCOPE();
 
-        if ((k = strstr(src, key)) == NULL)
-		return (PROC_MEMINFO_NO_KEY);
+	free(pb->data);
+	pb->data = NULL;
+	pb->len = 0;
+	pb->cap = 0;
+}
 
-	/* Skip everything until we found a whitespace. */
-	for (; *k != ' '; k++)
-		;
+int proc_do_parse_kv_line(const char *line, const char *end,
+			  const struct proc_kv_field *tbl, size_t n,
+			  size_t *hint, void *dst)
+{
+	const char *k;
+	size_t klen, i, j;
+	uint16_t v;
+	uint64_t *vals;
 
-	/* Skip everything (including whitespaces) until we
-	   found a digit. */
-	for (; !isdigit(*k); k++)
+	/* The key ends with either a colon or a whitespace. */
+	for (k = line; k < end && *k != ':' && *k != ' ' && *k != '\t'; k++)
 		;
+	klen = (size_t)(k - line);
 
-        for (; *k; k++) {
-		if (!isdigit(*k))
+	/* Start looking from the field after the last one found. */
+	for (j = 0, i = *hint; j < n; j++, i = i + 1 == n ? 0 : i + 1) {
+		if (tbl[i].klen == klen && *tbl[i].key == *line &&
+		    memcmp(tbl[i].key, line, klen) == 0)
 			break;
-	        if (gcc_mul_ovf_check(*dst, 10 + *k - '0', r))
-			return (-3);
+	}
+	if (j == n)
+		return (0);
+	*hint = i + 1 == n ? 0 : i + 1;
+
+	vals = (uint64_t *)((char *)dst + tbl[i].off);
+	for (v = 0; v < tbl[i].nvals; v++) {
+		/* Skip the separator and whitespaces. */
+		while (k < end && (*k < '0' || *k > '9'))
+			k++;
+		if (k == end)
+			break;
+
+		vals[v] = 0;
+		for (; k < end && *k >= '0' && *k <= '9'; k++)
+			vals[v] = vals[v] * 10 + (uint64_t)(*k - '0');
+	}
+
+	return (1);
+}
+
+size_t proc_do_parse_kv(const char *src, size_t len,
+			const struct proc_kv_field *tbl, size_t n,
+			void *dst)
+{
+	const char *line, *end, *nl;
+	size_t nfound, hint;
+	PROC_TRACE_SCOPE();
+
+	nfound = 0;
+	hint = 0;
+	end = src + len;
+	for (line = src; line < end; line = nl + 1) {
+		if ((nl = memchr(line, '\n', (size_t)(end - line))) == NULL)
+			nl = end;
+		nfound += (size_t)proc_do_parse_kv_line(line, nl, tbl, n,
+							 &hint, dst);
+	}
+
+	return (nfound);
+}
+
+int proc_do_read_kv(struct proc_buf *pb, const char *path,
+		    const struct proc_kv_field *tbl, size_t n,
+		    void *dst, size_t dst_size)
+{
+	int r;
+	PROC_TRACE_SCOPE();
+
+	memset(dst, '\0', dst_size);
+	if ((r = proc_do_buf_read(pb, path)) != PROC_KV_ALL_OKAY)
+		return (r);
+
+	proc_do_parse_kv(pb->data, pb->len, tbl, n, dst);
+	return (PROC_KV_ALL_OKAY);
+}
+
+int proc_do_read_meminfo(struct proc_buf *pb, struct proc_meminfo *pmi)
+{
+	PROC_TRACE_SCOPE();
+
+	return (proc_do_read_kv(pb, PROC_MEMINFO_PATH, proc_meminfo_kv,
+				PROC_KV_NFIELDS(proc_meminfo_kv), pmi,
+				sizeof(struct proc_meminfo)));
+}
+
+int proc_do_init_meminfo(struct proc_meminfo *pmi, char **p)
+{
+	struct proc_buf pb;
+	int r;
+	PROC_TRACE_SCOPE();
 
-		*dst = *dst * 10 + (unsigned)*k - '0';
+	memset(pmi, '\0', sizeof(struct proc_meminfo));
+	memset(&pb, '\0', sizeof(pb));
+	*p = NULL;
+	if ((r = proc_do_buf_read(&pb, PROC_MEMINFO_PATH)) != PROC_KV_ALL_OKAY) {
+		proc_do_buf_free(&pb);
+		return (r == PROC_KV_READ_FAILED ? PROC_MEMINFO_READ_FAILED : r);
 	}
-	
+
+	/* The caller owns the buffer now. */
+	*p = pb.data;
+	return (PROC_MEMINFO_ALL_OKAY);
+}
+
+int proc_do_get_kv(const char *src, const char *key, uint64_t *dst)
+{
+	struct proc_kv_field f;
+	size_t klen;
+
+	klen = strlen(key);
+	if (klen > 0 && key[klen - 1] == ':')
+		klen--;
+	f.key = key;
+	f.klen = (uint16_t)klen;
+	f.nvals = 1;
+	f.off = 0;
+	if (proc_do_parse_kv(src, strlen(src), &f, 1, dst) == 0)
+		return (PROC_MEMINFO_NO_KEY);
+
 	return (PROC_MEMINFO_ALL_OKAY);
 }
 
 void proc_do_collect_all(struct proc_meminfo *pmi, const char *src)
 {
-	proc_do_get_kv(src, "MemTotal:", &pmi->mem_total);
-	proc_do_get_kv(src, "MemFree:", &pmi->mem_free);
-	proc_do_get_kv(src, "MemAvailable:", &pmi->mem_avail);
-	proc_do_get_kv(src, "Buffers:", &pmi->buffers);
-	proc_do_get_kv(src, "Cached:", &pmi->cached);
-	proc_do_get_kv(src, "SwapCached:", &pmi->swap_cached);
-	proc_do_get_kv(src, "Active:", &pmi->active);	
-	proc_do_get_kv(src, "Inactive:", &pmi->inactive);
-	proc_do_get_kv(src, "Active(anon)", &pmi->active_anon);
-	proc_do_get_kv(src, "Inactive(anon):", &pmi->inactive_anon);
-	proc_do_get_kv(src, "Active(file):", &pmi->active_file);
-	proc_do_get_kv(src, "Inactive(file):", &pmi->inactive_file);
-	proc_do_get_kv(src, "Unevictable:", &pmi->unevictable);
-	proc_do_get_kv(src, "Mlocked:", &pmi->mlocked);
-	proc_do_get_kv(src, "HighTotal:", &pmi->high_total);
-	proc_do_get_kv(src, "HighFree:", &pmi->high_free);
-	proc_do_get_kv(src, "LowTotal:", &pmi->low_total);
-	proc_do_get_kv(src, "LowFree:", &pmi->low_free);
-	proc_do_get_kv(src, "MmapCopy:", &pmi->mmap_copy);
-	proc_do_get_kv(src, "SwapTotal:", &pmi->swap_total);
-	proc_do_get_kv(src, "SwapFree:", &pmi->swap_free);
-	proc_do_get_kv(src, "Zswap:", &pmi->zswap);
-	proc_do_get_kv(src, "Zswapped:", &pmi->zswapped);
-	proc_do_get_kv(src, "Dirty:", &pmi->dirty);
-	proc_do_get_kv(src, "Writeback:", &pmi->write_back);
-	proc_do_get_kv(src, "AnonPages:", &pmi->anon_pages);
-	proc_do_get_kv(src, "Mapped:", &pmi->mapped);
-	proc_do_get_kv(src, "Shmem:", &pmi->shmem);
-	proc_do_get_kv(src, "KReclaimable:", &pmi->k_reclaimable);
-	proc_do_get_kv(src, "Slab:", &pmi->slab);
-	proc_do_get_kv(src, "SReclaimable:", &pmi->s_reclaimable);
-	proc_do_get_kv(src, "SUnreclaim:", &pmi->s_unreclaim);
-	proc_do_get_kv(src, "KernelStack:", &pmi->kernel_stack);
-	proc_do_get_kv(src, "PageTables:", &pmi->page_tables);
-	proc_do_get_kv(src, "QuickLists:", &pmi->quick_lists);
-	proc_do_get_kv(src, "SecPageTables:", &pmi->sec_page_tables);
-	proc_do_get_kv(src, "NFS_Unstable:", &pmi->nfs_unstable);
-	proc_do_get_kv(src, "Bounce:", &pmi->bounce);
-	proc_do_get_kv(src, "WritebackTmp:", &pmi->write_back_tmp);
-	proc_do_get_kv(src, "CommitLimit:", &pmi->commit_limit);
-	proc_do_get_kv(src, "Committed_AS:", &pmi->committed_as);
-	proc_do_get_kv(src, "VmallocTotal:", &pmi->vm_alloc_total);
-	proc_do_get_kv(src, "VmallocUsed:", &pmi->vm_alloc_used);
-	proc_do_get_kv(src, "VmallocChunk:", &pmi->vm_alloc_chunk);
-	proc_do_get_kv(src, "Percpu:", &pmi->percpu);
-	proc_do_get_kv(src, "HardwareCorrupted:", &pmi->hardware_corrupted);
-	proc_do_get_kv(src, "LazyFree:", &pmi->lazy_free);
-	proc_do_get_kv(src, "AnonHugePages:", &pmi->anon_huge_pages);
-	proc_do_get_kv(src, "ShmemHugePages:", &pmi->shmem_huge_pages);
-	proc_do_get_kv(src, "ShmemPmdMapped:", &pmi->shmempmd_mapped);
-	proc_do_get_kv(src, "FileHugePages:", &pmi->file_huge_pages);
-	proc_do_get_kv(src, "FilePmdMapped:", &pmi->filepmd_mapped);
-	proc_do_get_kv(src, "HugePages_Total:", &pmi->huge_pages_total);
-	proc_do_get_kv(src, "HugePages_Free:", &pmi->huge_pages_free);
-	proc_do_get_kv(src, "HugePages_Rsvd:", &pmi->huge_pages_rsvd);
-	proc_do_get_kv(src, "HugePages_Surp:", &pmi->huge_pages_surp);
-	proc_do_get_kv(src, "Hugepagesize:", &pmi->huge_page_size);
-	proc_do_get_kv(src, "Hugetlb:", &pmi->hugetlb);
-
-	/* According to proc(5) these are only available for x86 CPUs. */
-#if defined (__i386__) || defined (__x86_64__)
-	proc_do_get_kv(src, "DirectMap4k:", &pmi->direct_map_4k);
-	proc_do_get_kv(src, "DirectMap2M:", &pmi->direct_map_2M);
-	proc_do_get_kv(src, "DirectMap4M:", &pmi->direct_map_4M);
-	proc_do_get_kv(src, "DirectMap1G:", &pmi->direct_map_1G);
-#endif /* __i386__, __x86_64__ */
-	
+	PROC_TRACE_SCOPE();
+
+	proc_do_parse_kv(src, strlen(src), proc_meminfo_kv,
+			 PROC_KV_NFIELDS(proc_meminfo_kv), pmi);
 }
 
 #endif /* MEMINFO_IMPL */
@@ -0,0 +1,150 @@
+/* Deltas, rates and moving averages between two meminfo samples. */
+
+#ifndef MEMRATE_H
+# define MEMRATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "procfs.h"
+
+/* struct proc_meminfo (and the other procfs.h structures) is only
+   made of uint64_t members, so it's treated as an array of them. */
+#define PROC_MEMINFO_NFIELDS						\
+	(sizeof(struct proc_meminfo) / sizeof(uint64_t))
+#define PROC_MEMINFO_IDX(member)					\
+	(offsetof(struct proc_meminfo, member) / sizeof(uint64_t))
+
+/* Constants. Used as return codes. */
+#define MEMRATE_ALL_OKAY      (0)
+#define MEMRATE_NO_TIME       (-1)
+
+/* Timestamped snapshot. */
+struct proc_meminfo_sample {
+	struct proc_meminfo mi;
+	/* CLOCK_MONOTONIC, in nanoseconds. */
+	uint64_t ts_ns;
+};
+
+/* Difference between two samples. Rates are per second, in the
+   unit of the field (kB for most of them). */
+struct proc_meminfo_delta {
+	int64_t delta[PROC_MEMINFO_NFIELDS];
+	double rate[PROC_MEMINFO_NFIELDS];
+	/* Elapsed seconds. */
+	double dt;
+};
+
+/* Exponentially weighted moving average of the rates. */
+struct proc_meminfo_ewma {
+	double rate[PROC_MEMINFO_NFIELDS];
+	/* Time constant, in seconds. */
+	double tau;
+	int primed;
+};
+
+/* Take a timestamped snapshot of /proc/meminfo. */
+extern int proc_do_meminfo_sample(struct proc_buf *pb,
+				  struct proc_meminfo_sample *s);
+/* Deltas and per-second rates of n counters. Works for any of the
+   procfs.h structures, e.g. pswpin/pswpout of struct proc_vmstat. */
+extern void proc_do_u64_delta(const uint64_t *prev, const uint64_t *cur,
+			      size_t n, double dt, int64_t *delta,
+			      double *rate);
+/* Moving average step of n values. */
+extern void proc_do_ewma_step(double *avg, const double *x, size_t n,
+			      double alpha);
+/* Deltas and rates between two meminfo samples. */
+extern int proc_do_meminfo_delta(const struct proc_meminfo_sample *prev,
+				 const struct proc_meminfo_sample *cur,
+				 struct proc_meminfo_delta *d);
+/* Initialize a moving average with a time constant in seconds. */
+extern void proc_do_meminfo_ewma_init(struct proc_meminfo_ewma *e,
+				      double tau);
+/* Feed a delta into the moving average. Deltas without elapsed time
+   (see MEMRATE_NO_TIME) are ignored, the first valid one seeds it. */
+extern void proc_do_meminfo_ewma_update(struct proc_meminfo_ewma *e,
+					const struct proc_meminfo_delta *d);
+
+#ifdef MEMRATE_IMPL
+
+#include <string.h>
+#include <time.h>
+
+int proc_do_meminfo_sample(struct proc_buf *pb, struct proc_meminfo_sample *s)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	s->ts_ns = (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+	return (proc_do_read_meminfo(pb, &s->mi));
+}
+
+/* Branch-free loops, so that the compiler can vectorize them. */
+void proc_do_u64_delta(const uint64_t *prev, const uint64_t *cur,
+		       size_t n, double dt, int64_t *delta, double *rate)
+{
+	size_t i;
+	double inv_dt;
+
+	inv_dt = dt > 0 ? 1.0 / dt : 0;
+	for (i = 0; i < n; i++)
+		delta[i] = (int64_t)(cur[i] - prev[i]);
+	for (i = 0; i < n; i++)
+		rate[i] = (double)delta[i] * inv_dt;
+}
+
+void proc_do_ewma_step(double *avg, const double *x, size_t n,
+		       double alpha)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		avg[i] += alpha * (x[i] - avg[i]);
+}
+
+int proc_do_meminfo_delta(const struct proc_meminfo_sample *prev,
+			  const struct proc_meminfo_sample *cur,
+			  struct proc_meminfo_delta *d)
+{
+	if (cur->ts_ns <= prev->ts_ns) {
+		memset(d, '\0', sizeof(struct proc_meminfo_delta));
+		return (MEMRATE_NO_TIME);
+	}
+
+	d->dt = (double)(cur->ts_ns - prev->ts_ns) / 1e9;
+	proc_do_u64_delta((const uint64_t *)&prev->mi,
+			  (const uint64_t *)&cur->mi,
+			  PROC_MEMINFO_NFIELDS, d->dt, d->delta, d->rate);
+	return (MEMRATE_ALL_OKAY);
+}
+
+void proc_do_meminfo_ewma_init(struct proc_meminfo_ewma *e, double tau)
+{
+	memset(e, '\0', sizeof(struct proc_meminfo_ewma));
+	e->tau = tau;
+}
+
+void proc_do_meminfo_ewma_update(struct proc_meminfo_ewma *e,
+				 const struct proc_meminfo_delta *d)
+{
+	/* No rate to average, and dt / (tau + dt) is NaN when tau is 0. */
+	if (!(d->dt > 0))
+		return;
+
+	if (!e->primed) {
+		memcpy(e->rate, d->rate, sizeof(e->rate));
+		e->primed = 1;
+		return;
+	}
+
+	/* First order approximation of 1 - exp(-dt / tau), so that
+	   irregular sampling intervals are weighted correctly without
+	   pulling in libm. */
+	proc_do_ewma_step(e->rate, d->rate, PROC_MEMINFO_NFIELDS,
+			  d->dt / (e->tau + d->dt));
+}
+
+#endif /* MEMRATE_IMPL */
+
+#endif /* MEMRATE_H */
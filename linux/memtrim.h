@@ -0,0 +1,197 @@
+/* Give memory back under pressure. Pools and caches register a trim
+   callback, and memtrim_do_tick(), called from a timer or a PSI
+   wakeup (see psi.h), asks them to drop a fraction of their idle
+   memory in proportion to how tight /proc/meminfo looks:
+     static size_t trim_pool(void *arg, double fraction)
+     {
+	     return (hpool_do_trim(arg, fraction));
+     }
+     memtrim_do_register("nodes", trim_pool, &pool);
+   Needs -pthread. */
+
+#ifndef MEMTRIM_H
+# define MEMTRIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "procfs.h"
+
+/* Upper bound of registered callbacks. */
+#ifndef MEMTRIM_MAX_CALLBACKS
+# define MEMTRIM_MAX_CALLBACKS     (32)
+#endif
+
+/* Constants. Used as return codes. */
+#define MEMTRIM_TOO_MANY           (-1)
+
+/* Release about fraction (0, 1] of the idle memory, returns the
+   number of bytes released. Called with the registry locked, so it
+   must not (un)register. */
+typedef size_t (*memtrim_fn)(void *arg, double fraction);
+
+/* Trimming starts when either ratio crosses its start value, and
+   grows linearly up to a fraction of 1 at the full value. */
+struct memtrim_policy {
+	/* MemAvailable / MemTotal. */
+	double avail_start;
+	double avail_full;
+	/* Committed_AS / CommitLimit. */
+	double commit_start;
+	double commit_full;
+};
+
+#define MEMTRIM_POLICY_DEFAULT     { 0.20, 0.05, 0.90, 1.00 }
+
+/* Register a callback, returns its id, or MEMTRIM_TOO_MANY. */
+extern int memtrim_do_register(const char *name, memtrim_fn fn, void *arg);
+/* Unregister a callback, waits for a trim that is running. */
+extern void memtrim_do_unregister(int id);
+/* Run every callback, returns the number of bytes released. */
+extern size_t memtrim_do_trim(double fraction);
+/* Fraction to trim, 0 when there's no pressure. */
+extern double memtrim_do_pressure(const struct memtrim_policy *pol,
+				  const struct proc_meminfo *pmi);
+/* Read PROC_MEMINFO_PATH, and trim if needed. fraction and released
+   may be NULL. Returns 0, or a PROC_KV_* constant. */
+extern int memtrim_do_tick(const struct memtrim_policy *pol,
+			   struct proc_buf *pb, double *fraction,
+			   size_t *released);
+/* madvise(MADV_DONTNEED) the whole pages within [addr, addr + len),
+   returns the number of bytes released. */
+extern size_t memtrim_do_dontneed(void *addr, size_t len);
+
+#ifdef MEMTRIM_IMPL
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+struct memtrim_entry {
+	const char *name;
+	memtrim_fn fn;
+	void *arg;
+};
+
+static struct memtrim_entry memtrim_entries[MEMTRIM_MAX_CALLBACKS];
+static pthread_mutex_t memtrim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int memtrim_do_register(const char *name, memtrim_fn fn, void *arg)
+{
+	int i;
+
+	pthread_mutex_lock(&memtrim_lock);
+	for (i = 0; i < MEMTRIM_MAX_CALLBACKS; i++) {
+		if (memtrim_entries[i].fn == NULL)
+			break;
+	}
+	if (i < MEMTRIM_MAX_CALLBACKS) {
+		memtrim_entries[i].name = name;
+		memtrim_entries[i].fn = fn;
+		memtrim_entries[i].arg = arg;
+	}
+	pthread_mutex_unlock(&memtrim_lock);
+
+	return (i < MEMTRIM_MAX_CALLBACKS ? i : MEMTRIM_TOO_MANY);
+}
+
+void memtrim_do_unregister(int id)
+{
+	if (id < 0 || id >= MEMTRIM_MAX_CALLBACKS)
+		return;
+	pthread_mutex_lock(&memtrim_lock);
+	memtrim_entries[id].fn = NULL;
+	pthread_mutex_unlock(&memtrim_lock);
+}
+
+size_t memtrim_do_trim(double fraction)
+{
+	size_t released;
+	int i;
+
+	if (fraction <= 0)
+		return (0);
+	if (fraction > 1)
+		fraction = 1;
+
+	released = 0;
+	pthread_mutex_lock(&memtrim_lock);
+	for (i = 0; i < MEMTRIM_MAX_CALLBACKS; i++) {
+		if (memtrim_entries[i].fn != NULL)
+			released += memtrim_entries[i].fn(memtrim_entries[i].arg,
+							  fraction);
+	}
+	pthread_mutex_unlock(&memtrim_lock);
+
+	return (released);
+}
+
+/* Where v lies from start (0) to full (1), either way round. A step
+   when both are equal, which has no way round of its own. */
+static double memtrim_ramp(double v, double start, double full,
+			   int higher_is_worse)
+{
+	double f;
+
+	if (start == full)
+		return (higher_is_worse ? v >= full : v <= full);
+	f = (v - start) / (full - start);
+	return (f < 0 ? 0 : f > 1 ? 1 : f);
+}
+
+double memtrim_do_pressure(const struct memtrim_policy *pol,
+			   const struct proc_meminfo *pmi)
+{
+	double avail, commit;
+
+	avail = 0;
+	commit = 0;
+	if (pmi->mem_total != 0)
+		avail = memtrim_ramp((double)pmi->mem_avail /
+				     (double)pmi->mem_total,
+				     pol->avail_start, pol->avail_full, 0);
+	if (pmi->commit_limit != 0)
+		commit = memtrim_ramp((double)pmi->committed_as /
+				      (double)pmi->commit_limit,
+				      pol->commit_start, pol->commit_full, 1);
+
+	return (avail > commit ? avail : commit);
+}
+
+int memtrim_do_tick(const struct memtrim_policy *pol, struct proc_buf *pb,
+		    double *fraction, size_t *released)
+{
+	struct proc_meminfo mi;
+	double f;
+	size_t r;
+	int ret;
+
+	if ((ret = proc_do_read_meminfo(pb, &mi)) != PROC_KV_ALL_OKAY)
+		return (ret);
+
+	f = memtrim_do_pressure(pol, &mi);
+	r = memtrim_do_trim(f);
+	if (fraction != NULL)
+		*fraction = f;
+	if (released != NULL)
+		*released = r;
+	return (PROC_KV_ALL_OKAY);
+}
+
+size_t memtrim_do_dontneed(void *addr, size_t len)
+{
+	uintptr_t start, end, page;
+
+	page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	start = ((uintptr_t)addr + page - 1) & ~(page - 1);
+	end = ((uintptr_t)addr + len) & ~(page - 1);
+	if (end <= start || madvise((void *)start, end - start,
+				    MADV_DONTNEED) == -1)
+		return (0);
+
+	return ((size_t)(end - start));
+}
+
+#endif /* MEMTRIM_IMPL */
+
+#endif /* MEMTRIM_H */
@@ -0,0 +1,271 @@
+/* Per-NUMA-node meminfo (/sys/devices/system/node/nodeN/meminfo). */
+
+#ifndef NUMA_H
+# define NUMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "procfs.h"
+
+#ifndef SYS_NODE_PATH
+# define SYS_NODE_PATH      "/sys/devices/system/node"
+#endif
+
+/* Maximum number of nodes that are sampled. */
+#ifndef NUMA_MAX_NODES
+# define NUMA_MAX_NODES     (64)
+#endif
+
+/* Constants. Used as return codes, the first ones share their
+   values with PROC_KV_*. */
+#define NUMA_ALL_OKAY       (0)
+#define NUMA_OPEN_FAILED    (-1)
+#define NUMA_ALLOC_FAILED   (-2)
+#define NUMA_READ_FAILED    (-3)
+#define NUMA_NO_NODES       (-4)
+
+/* Members that exists in a node meminfo file, in kB (pages for
+   the HugePages_* ones). */
+struct proc_node_meminfo {
+	uint64_t mem_total;
+	uint64_t mem_free;
+	uint64_t mem_used;
+	uint64_t swap_cached;
+	uint64_t active;
+	uint64_t inactive;
+	uint64_t active_anon;
+	uint64_t inactive_anon;
+	uint64_t active_file;
+	uint64_t inactive_file;
+	uint64_t unevictable;
+	uint64_t mlocked;
+	uint64_t dirty;
+	uint64_t write_back;
+	uint64_t file_pages;
+	uint64_t mapped;
+	uint64_t anon_pages;
+	uint64_t shmem;
+	uint64_t kernel_stack;
+	uint64_t page_tables;
+	uint64_t sec_page_tables;
+	uint64_t nfs_unstable;
+	uint64_t bounce;
+	uint64_t write_back_tmp;
+	uint64_t k_reclaimable;
+	uint64_t slab;
+	uint64_t s_reclaimable;
+	uint64_t s_unreclaim;
+	uint64_t anon_huge_pages;
+	uint64_t shmem_huge_pages;
+	uint64_t shmempmd_mapped;
+	uint64_t file_huge_pages;
+	uint64_t filepmd_mapped;
+	uint64_t huge_pages_total;
+	uint64_t huge_pages_free;
+	uint64_t huge_pages_surp;
+};
+
+/* Sampler for all nodes. The meminfo files are opened once, and
+   re-read into the same buffer on every sample. */
+struct numa_meminfo {
+	int ids[NUMA_MAX_NODES];
+	int fds[NUMA_MAX_NODES];
+	struct proc_node_meminfo nodes[NUMA_MAX_NODES];
+	size_t nnodes;
+	struct proc_buf pb;
+};
+
+/* Find and open every node below base (SYS_NODE_PATH if NULL). Nothing
+   is left open on failure. */
+extern int numa_do_init(struct numa_meminfo *nm, const char *base);
+/* Sample all nodes at once. */
+extern int numa_do_sample(struct numa_meminfo *nm);
+/* Estimate of the memory available on a node without swapping,
+   in kB. */
+extern uint64_t numa_do_node_avail(const struct proc_node_meminfo *ni);
+/* Close all files and free the buffer. */
+extern void numa_do_close(struct numa_meminfo *nm);
+
+#ifdef NUMA_IMPL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+static const struct proc_kv_field numa_meminfo_kv[] = {
+	PROC_KV_FIELD("MemTotal", struct proc_node_meminfo, mem_total),
+	PROC_KV_FIELD("MemFree", struct proc_node_meminfo, mem_free),
+	PROC_KV_FIELD("MemUsed", struct proc_node_meminfo, mem_used),
+	PROC_KV_FIELD("SwapCached", struct proc_node_meminfo, swap_cached),
+	PROC_KV_FIELD("Active", struct proc_node_meminfo, active),
+	PROC_KV_FIELD("Inactive", struct proc_node_meminfo, inactive),
+	PROC_KV_FIELD("Active(anon)", struct proc_node_meminfo, active_anon),
+	PROC_KV_FIELD("Inactive(anon)", struct proc_node_meminfo,
+		      inactive_anon),
+	PROC_KV_FIELD("Active(file)", struct proc_node_meminfo, active_file),
+	PROC_KV_FIELD("Inactive(file)", struct proc_node_meminfo,
+		      inactive_file),
+	PROC_KV_FIELD("Unevictable", struct proc_node_meminfo, unevictable),
+	PROC_KV_FIELD("Mlocked", struct proc_node_meminfo, mlocked),
+	PROC_KV_FIELD("Dirty", struct proc_node_meminfo, dirty),
+	PROC_KV_FIELD("Writeback", struct proc_node_meminfo, write_back),
+	PROC_KV_FIELD("FilePages", struct proc_node_meminfo, file_pages),
+	PROC_KV_FIELD("Mapped", struct proc_node_meminfo, mapped),
+	PROC_KV_FIELD("AnonPages", struct proc_node_meminfo, anon_pages),
+	PROC_KV_FIELD("Shmem", struct proc_node_meminfo, shmem),
+	PROC_KV_FIELD("KernelStack", struct proc_node_meminfo, kernel_stack),
+	PROC_KV_FIELD("PageTables", struct proc_node_meminfo, page_tables),
+	PROC_KV_FIELD("SecPageTables", struct proc_node_meminfo,
+		      sec_page_tables),
+	PROC_KV_FIELD("NFS_Unstable", struct proc_node_meminfo, nfs_unstable),
+	PROC_KV_FIELD("Bounce", struct proc_node_meminfo, bounce),
+	PROC_KV_FIELD("WritebackTmp", struct proc_node_meminfo,
+		      write_back_tmp),
+	PROC_KV_FIELD("KReclaimable", struct proc_node_meminfo, k_reclaimable),
+	PROC_KV_FIELD("Slab", struct proc_node_meminfo, slab),
+	PROC_KV_FIELD("SReclaimable", struct proc_node_meminfo, s_reclaimable),
+	PROC_KV_FIELD("SUnreclaim", struct proc_node_meminfo, s_unreclaim),
+	PROC_KV_FIELD("AnonHugePages", struct proc_node_meminfo,
+		      anon_huge_pages),
+	PROC_KV_FIELD("ShmemHugePages", struct proc_node_meminfo,
+		      shmem_huge_pages),
+	PROC_KV_FIELD("ShmemPmdMapped", struct proc_node_meminfo,
+		      shmempmd_mapped),
+	PROC_KV_FIELD("FileHugePages", struct proc_node_meminfo,
+		      file_huge_pages),
+	PROC_KV_FIELD("FilePmdMapped", struct proc_node_meminfo,
+		      filepmd_mapped),
+	PROC_KV_FIELD("HugePages_Total", struct proc_node_meminfo,
+		      huge_pages_total),
+	PROC_KV_FIELD("HugePages_Free", struct proc_node_meminfo,
+		      huge_pages_free),
+	PROC_KV_FIELD("HugePages_Surp", struct proc_node_meminfo,
+		      huge_pages_surp),
+};
+
+/* Returns the node number of a "nodeN" entry, or -1. */
+static int numa_node_id(const char *name)
+{
+	const char *k;
+	int id;
+
+	if (strncmp(name, "node", 4) != 0 || name[4] == '\0')
+		return (-1);
+
+	id = 0;
+	for (k = name + 4; *k; k++) {
+		if (*k < '0' || *k > '9')
+			return (-1);
+		id = id * 10 + (*k - '0');
+	}
+
+	return (id);
+}
+
+int numa_do_init(struct numa_meminfo *nm, const char *base)
+{
+	DIR *d;
+	struct dirent *de;
+	char path[4096];
+	int id, fd, r;
+	size_t i, j;
+
+	memset(nm, '\0', sizeof(struct numa_meminfo));
+	if (base == NULL)
+		base = SYS_NODE_PATH;
+	if ((d = opendir(base)) == NULL)
+		return (NUMA_OPEN_FAILED);
+
+	while ((de = readdir(d)) != NULL && nm->nnodes < NUMA_MAX_NODES) {
+		if ((id = numa_node_id(de->d_name)) == -1)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s/meminfo", base, de->d_name);
+		if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+			continue;
+
+		/* Keep the nodes sorted by their number. */
+		for (i = nm->nnodes; i > 0 && nm->ids[i - 1] > id; i--)
+			;
+		for (j = nm->nnodes; j > i; j--) {
+			nm->ids[j] = nm->ids[j - 1];
+			nm->fds[j] = nm->fds[j - 1];
+		}
+		nm->ids[i] = id;
+		nm->fds[i] = fd;
+		nm->nnodes++;
+	}
+	closedir(d);
+
+	if (nm->nnodes == 0)
+		return (NUMA_NO_NODES);
+
+	/* Size the buffer once, so samples don't allocate. */
+	if ((r = proc_do_buf_pread(&nm->pb, nm->fds[0])) != PROC_KV_ALL_OKAY)
+		numa_do_close(nm);
+	return (r);
+}
+
+int numa_do_sample(struct numa_meminfo *nm)
+{
+	int r;
+	size_t i, hint;
+	const char *line, *end, *nl, *k;
+
+	for (i = 0; i < nm->nnodes; i++) {
+		memset(&nm->nodes[i], '\0', sizeof(struct proc_node_meminfo));
+		if ((r = proc_do_buf_pread(&nm->pb, nm->fds[i])) != PROC_KV_ALL_OKAY)
+			return (r);
+
+		hint = 0;
+		end = nm->pb.data + nm->pb.len;
+		for (line = nm->pb.data; line < end; line = nl + 1) {
+			if ((nl = memchr(line, '\n', (size_t)(end - line))) == NULL)
+				nl = end;
+
+			/* Skip the "Node N" prefix. */
+			k = line;
+			if (nl - k > 5 && memcmp(k, "Node ", 5) == 0) {
+				for (k += 5; k < nl && *k >= '0' && *k <= '9'; k++)
+					;
+				for (; k < nl && *k == ' '; k++)
+					;
+			}
+
+			proc_do_parse_kv_line(k, nl, numa_meminfo_kv,
+					      PROC_KV_NFIELDS(numa_meminfo_kv),
+					      &hint, &nm->nodes[i]);
+		}
+	}
+
+	return (NUMA_ALL_OKAY);
+}
+
+uint64_t numa_do_node_avail(const struct proc_node_meminfo *ni)
+{
+	uint64_t pagecache;
+
+	/* Same idea as MemAvailable, but without the zone watermarks
+	   (which would need /proc/zoneinfo): only half of the page
+	   cache and of the reclaimable kernel memory is counted. */
+	pagecache = ni->active_file + ni->inactive_file;
+	return (ni->mem_free + pagecache / 2 + ni->k_reclaimable / 2);
+}
+
+void numa_do_close(struct numa_meminfo *nm)
+{
+	size_t i;
+
+	for (i = 0; i < nm->nnodes; i++)
+		close(nm->fds[i]);
+	nm->nnodes = 0;
+	proc_do_buf_free(&nm->pb);
+}
+
+#endif /* NUMA_IMPL */
+
+#endif /* NUMA_H */
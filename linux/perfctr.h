@@ -0,0 +1,204 @@
+/* Hardware performance counters (perf_event_open(2)) around a
+   benchmarked region. Counters the kernel refuses (no PMU, a
+   restrictive perf_event_paranoid, ...) are reported as -1. */
+
+#ifndef PERFCTR_H
+# define PERFCTR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../bench.h"
+
+/* Counters, also indexes of the arrays below. */
+#define PERF_CTR_CYCLES           (0)
+#define PERF_CTR_INSTRUCTIONS     (1)
+#define PERF_CTR_CACHE_MISSES     (2)
+#define PERF_CTR_BRANCH_MISSES    (3)
+#define PERF_CTR_DTLB_MISSES      (4)
+#define PERF_CTR_COUNT            (5)
+
+/* Value of a counter that didn't count: it couldn't be read, or the
+   kernel never scheduled it on the PMU (time running of 0). */
+#define PERF_CTR_NOT_COUNTED      (UINT64_MAX)
+
+struct perf_ctrs {
+	/* -1 for counters that couldn't be opened. */
+	int fds[PERF_CTR_COUNT];
+	/* Values of the last measured region, scaled when the kernel
+	   had to multiplex the counters, or PERF_CTR_NOT_COUNTED. */
+	uint64_t vals[PERF_CTR_COUNT];
+	int navail;
+};
+
+struct perf_ctr_result {
+	const char *name;
+	uint64_t iters;
+	/* Per operation, -1 if the counter is unavailable or didn't
+	   count (printed as n/a). */
+	double per_op[PERF_CTR_COUNT];
+};
+
+/* Open the counters for the calling thread (user space only).
+   Returns the number of counters available, possibly 0. */
+extern int perf_ctr_do_open(struct perf_ctrs *pc);
+/* Reset and start counting. */
+extern void perf_ctr_do_start(struct perf_ctrs *pc);
+/* Stop counting, and read the values into pc->vals. */
+extern void perf_ctr_do_stop(struct perf_ctrs *pc);
+/* Close the counters. */
+extern void perf_ctr_do_close(struct perf_ctrs *pc);
+/* Run fn for iters iterations between start and stop. */
+extern void perf_ctr_do_bench(struct perf_ctrs *pc, const char *name,
+			      bench_fn fn, void *arg, uint64_t iters,
+			      struct perf_ctr_result *res);
+/* Print a result in a human readable form. */
+extern void perf_ctr_do_print(FILE *fp, const struct perf_ctr_result *res);
+
+#ifdef PERFCTR_IMPL
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static const char *perf_ctr_names[PERF_CTR_COUNT] = {
+	"cycles", "instructions", "cache-misses", "branch-misses",
+	"dTLB-misses"
+};
+
+static void perf_ctr_attr(struct perf_event_attr *pe, int ctr)
+{
+	memset(pe, '\0', sizeof(struct perf_event_attr));
+	pe->size = sizeof(struct perf_event_attr);
+	pe->type = PERF_TYPE_HARDWARE;
+	pe->disabled = 1;
+	pe->exclude_kernel = 1;
+	pe->exclude_hv = 1;
+	pe->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+		PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	switch (ctr) {
+	case PERF_CTR_CYCLES:
+		pe->config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PERF_CTR_INSTRUCTIONS:
+		pe->config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PERF_CTR_CACHE_MISSES:
+		pe->config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case PERF_CTR_BRANCH_MISSES:
+		pe->config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case PERF_CTR_DTLB_MISSES:
+		pe->type = PERF_TYPE_HW_CACHE;
+		pe->config = PERF_COUNT_HW_CACHE_DTLB |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	}
+}
+
+int perf_ctr_do_open(struct perf_ctrs *pc)
+{
+	struct perf_event_attr pe;
+	int i;
+
+	memset(pc, '\0', sizeof(struct perf_ctrs));
+	/* Each counter is opened on its own instead of as a group, so
+	   that a missing one doesn't take the others with it. */
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		perf_ctr_attr(&pe, i);
+		pc->fds[i] = (int)syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+		if (pc->fds[i] != -1)
+			pc->navail++;
+	}
+
+	return (pc->navail);
+}
+
+void perf_ctr_do_start(struct perf_ctrs *pc)
+{
+	int i;
+
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		if (pc->fds[i] == -1)
+			continue;
+		ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+void perf_ctr_do_stop(struct perf_ctrs *pc)
+{
+	/* value, time enabled, time running. */
+	uint64_t buf[3];
+	int i;
+
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		if (pc->fds[i] != -1)
+			ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		pc->vals[i] = PERF_CTR_NOT_COUNTED;
+		if (pc->fds[i] == -1 ||
+		    read(pc->fds[i], buf, sizeof(buf)) != sizeof(buf))
+			continue;
+		/* Not a 0 count: nothing is known about it. */
+		if (buf[2] == 0)
+			continue;
+		pc->vals[i] = buf[2] < buf[1] ?
+			(uint64_t)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+	}
+}
+
+void perf_ctr_do_close(struct perf_ctrs *pc)
+{
+	int i;
+
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		if (pc->fds[i] != -1)
+			close(pc->fds[i]);
+		pc->fds[i] = -1;
+	}
+	pc->navail = 0;
+}
+
+void perf_ctr_do_bench(struct perf_ctrs *pc, const char *name,
+		       bench_fn fn, void *arg, uint64_t iters,
+		       struct perf_ctr_result *res)
+{
+	int i;
+
+	perf_ctr_do_start(pc);
+	fn(arg, iters);
+	perf_ctr_do_stop(pc);
+
+	res->name = name;
+	res->iters = iters;
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		res->per_op[i] = pc->vals[i] == PERF_CTR_NOT_COUNTED ? -1 :
+			(double)pc->vals[i] / (double)iters;
+	}
+}
+
+void perf_ctr_do_print(FILE *fp, const struct perf_ctr_result *res)
+{
+	int i;
+
+	fprintf(fp, "%-32s", res->name);
+	for (i = 0; i < PERF_CTR_COUNT; i++) {
+		if (res->per_op[i] < 0)
+			fprintf(fp, " %s n/a", perf_ctr_names[i]);
+		else
+			fprintf(fp, " %s %.2f", perf_ctr_names[i], res->per_op[i]);
+	}
+	fprintf(fp, " (per op)\n");
+}
+
+#endif /* PERFCTR_IMPL */
+
+#endif /* PERFCTR_H */
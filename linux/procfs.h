@@ -0,0 +1,326 @@
+/* Typed readers of /proc pseudo files, on top of the key-value
+   engine of meminfo.h. */
+
+#ifndef PROCFS_H
+# define PROCFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The engine and the meminfo reader live in meminfo.h. */
+#if defined (PROCFS_IMPL) && !defined (MEMINFO_IMPL)
+# define MEMINFO_IMPL
+#endif
+#include "meminfo.h"
+
+#ifndef PROC_VMSTAT_PATH
+# define PROC_VMSTAT_PATH          "/proc/vmstat"
+#endif
+#ifndef PROC_SELF_STATUS_PATH
+# define PROC_SELF_STATUS_PATH     "/proc/self/status"
+#endif
+#ifndef PROC_SMAPS_ROLLUP_PATH
+# define PROC_SMAPS_ROLLUP_PATH    "/proc/self/smaps_rollup"
+#endif
+#ifndef PROC_STAT_PATH
+# define PROC_STAT_PATH            "/proc/stat"
+#endif
+
+/* /proc/vmstat, in pages or events. */
+struct proc_vmstat {
+	uint64_t nr_free_pages;
+	uint64_t nr_inactive_anon;
+	uint64_t nr_active_anon;
+	uint64_t nr_inactive_file;
+	uint64_t nr_active_file;
+	uint64_t nr_unevictable;
+	uint64_t nr_mlock;
+	uint64_t nr_anon_pages;
+	uint64_t nr_mapped;
+	uint64_t nr_file_pages;
+	uint64_t nr_dirty;
+	uint64_t nr_writeback;
+	uint64_t nr_shmem;
+	uint64_t nr_slab_reclaimable;
+	uint64_t nr_slab_unreclaimable;
+	uint64_t nr_page_table_pages;
+	uint64_t nr_kernel_stack;
+	uint64_t nr_dirtied;
+	uint64_t nr_written;
+	uint64_t workingset_refault_anon;
+	uint64_t workingset_refault_file;
+	uint64_t pgpgin;
+	uint64_t pgpgout;
+	uint64_t pswpin;
+	uint64_t pswpout;
+	uint64_t pgfree;
+	uint64_t pgactivate;
+	uint64_t pgdeactivate;
+	uint64_t pgfault;
+	uint64_t pgmajfault;
+	uint64_t pgrefill;
+	uint64_t pgsteal_kswapd;
+	uint64_t pgsteal_direct;
+	uint64_t pgscan_kswapd;
+	uint64_t pgscan_direct;
+	uint64_t slabs_scanned;
+	uint64_t allocstall_normal;
+	uint64_t compact_stall;
+	uint64_t compact_fail;
+	uint64_t compact_success;
+	uint64_t thp_fault_alloc;
+	uint64_t thp_fault_fallback;
+	uint64_t oom_kill;
+};
+
+/* /proc/self/status, memory values are in kB. */
+struct proc_self_status {
+	uint64_t pid;
+	uint64_t ppid;
+	uint64_t vm_peak;
+	uint64_t vm_size;
+	uint64_t vm_lck;
+	uint64_t vm_pin;
+	uint64_t vm_hwm;
+	uint64_t vm_rss;
+	uint64_t rss_anon;
+	uint64_t rss_file;
+	uint64_t rss_shmem;
+	uint64_t vm_data;
+	uint64_t vm_stk;
+	uint64_t vm_exe;
+	uint64_t vm_lib;
+	uint64_t vm_pte;
+	uint64_t vm_swap;
+	uint64_t hugetlb_pages;
+	uint64_t threads;
+	uint64_t voluntary_ctxt_switches;
+	uint64_t nonvoluntary_ctxt_switches;
+};
+
+/* /proc/self/smaps_rollup, in kB. */
+struct proc_smaps_rollup {
+	uint64_t rss;
+	uint64_t pss;
+	uint64_t pss_dirty;
+	uint64_t pss_anon;
+	uint64_t pss_file;
+	uint64_t pss_shmem;
+	uint64_t shared_clean;
+	uint64_t shared_dirty;
+	uint64_t private_clean;
+	uint64_t private_dirty;
+	uint64_t referenced;
+	uint64_t anonymous;
+	uint64_t ksm;
+	uint64_t lazy_free;
+	uint64_t anon_huge_pages;
+	uint64_t shmem_pmd_mapped;
+	uint64_t file_pmd_mapped;
+	uint64_t shared_hugetlb;
+	uint64_t private_hugetlb;
+	uint64_t swap;
+	uint64_t swap_pss;
+	uint64_t locked;
+};
+
+/* Aggregated "cpu" line of /proc/stat, in USER_HZ. */
+struct proc_stat_cpu {
+	uint64_t user;
+	uint64_t nice;
+	uint64_t system;
+	uint64_t idle;
+	uint64_t iowait;
+	uint64_t irq;
+	uint64_t softirq;
+	uint64_t steal;
+	uint64_t guest;
+	uint64_t guest_nice;
+};
+
+/* /proc/stat. Per-CPU lines are skipped, only the first (total)
+   value of "intr" and "softirq" is kept. */
+struct proc_stat {
+	struct proc_stat_cpu cpu;
+	uint64_t intr;
+	uint64_t ctxt;
+	uint64_t btime;
+	uint64_t processes;
+	uint64_t procs_running;
+	uint64_t procs_blocked;
+	uint64_t softirq;
+};
+
+/* Typed readers, proc_do_read_meminfo() is in meminfo.h. */
+extern int proc_do_read_vmstat(struct proc_buf *pb,
+			       struct proc_vmstat *vs);
+extern int proc_do_read_self_status(struct proc_buf *pb,
+				    struct proc_self_status *ss);
+extern int proc_do_read_smaps_rollup(struct proc_buf *pb,
+				     struct proc_smaps_rollup *sr);
+extern int proc_do_read_stat(struct proc_buf *pb, struct proc_stat *st);
+
+#ifdef PROCFS_IMPL
+
+static const struct proc_kv_field proc_vmstat_kv[] = {
+	PROC_KV_FIELD("nr_free_pages", struct proc_vmstat, nr_free_pages),
+	PROC_KV_FIELD("nr_inactive_anon", struct proc_vmstat, nr_inactive_anon),
+	PROC_KV_FIELD("nr_active_anon", struct proc_vmstat, nr_active_anon),
+	PROC_KV_FIELD("nr_inactive_file", struct proc_vmstat, nr_inactive_file),
+	PROC_KV_FIELD("nr_active_file", struct proc_vmstat, nr_active_file),
+	PROC_KV_FIELD("nr_unevictable", struct proc_vmstat, nr_unevictable),
+	PROC_KV_FIELD("nr_mlock", struct proc_vmstat, nr_mlock),
+	PROC_KV_FIELD("nr_anon_pages", struct proc_vmstat, nr_anon_pages),
+	PROC_KV_FIELD("nr_mapped", struct proc_vmstat, nr_mapped),
+	PROC_KV_FIELD("nr_file_pages", struct proc_vmstat, nr_file_pages),
+	PROC_KV_FIELD("nr_dirty", struct proc_vmstat, nr_dirty),
+	PROC_KV_FIELD("nr_writeback", struct proc_vmstat, nr_writeback),
+	PROC_KV_FIELD("nr_shmem", struct proc_vmstat, nr_shmem),
+	PROC_KV_FIELD("nr_slab_reclaimable", struct proc_vmstat,
+		      nr_slab_reclaimable),
+	PROC_KV_FIELD("nr_slab_unreclaimable", struct proc_vmstat,
+		      nr_slab_unreclaimable),
+	PROC_KV_FIELD("nr_page_table_pages", struct proc_vmstat,
+		      nr_page_table_pages),
+	PROC_KV_FIELD("nr_kernel_stack", struct proc_vmstat, nr_kernel_stack),
+	PROC_KV_FIELD("nr_dirtied", struct proc_vmstat, nr_dirtied),
+	PROC_KV_FIELD("nr_written", struct proc_vmstat, nr_written),
+	PROC_KV_FIELD("workingset_refault_anon", struct proc_vmstat,
+		      workingset_refault_anon),
+	PROC_KV_FIELD("workingset_refault_file", struct proc_vmstat,
+		      workingset_refault_file),
+	PROC_KV_FIELD("pgpgin", struct proc_vmstat, pgpgin),
+	PROC_KV_FIELD("pgpgout", struct proc_vmstat, pgpgout),
+	PROC_KV_FIELD("pswpin", struct proc_vmstat, pswpin),
+	PROC_KV_FIELD("pswpout", struct proc_vmstat, pswpout),
+	PROC_KV_FIELD("pgfree", struct proc_vmstat, pgfree),
+	PROC_KV_FIELD("pgactivate", struct proc_vmstat, pgactivate),
+	PROC_KV_FIELD("pgdeactivate", struct proc_vmstat, pgdeactivate),
+	PROC_KV_FIELD("pgfault", struct proc_vmstat, pgfault),
+	PROC_KV_FIELD("pgmajfault", struct proc_vmstat, pgmajfault),
+	PROC_KV_FIELD("pgrefill", struct proc_vmstat, pgrefill),
+	PROC_KV_FIELD("pgsteal_kswapd", struct proc_vmstat, pgsteal_kswapd),
+	PROC_KV_FIELD("pgsteal_direct", struct proc_vmstat, pgsteal_direct),
+	PROC_KV_FIELD("pgscan_kswapd", struct proc_vmstat, pgscan_kswapd),
+	PROC_KV_FIELD("pgscan_direct", struct proc_vmstat, pgscan_direct),
+	PROC_KV_FIELD("slabs_scanned", struct proc_vmstat, slabs_scanned),
+	PROC_KV_FIELD("allocstall_normal", struct proc_vmstat,
+		      allocstall_normal),
+	PROC_KV_FIELD("compact_stall", struct proc_vmstat, compact_stall),
+	PROC_KV_FIELD("compact_fail", struct proc_vmstat, compact_fail),
+	PROC_KV_FIELD("compact_success", struct proc_vmstat, compact_success),
+	PROC_KV_FIELD("thp_fault_alloc", struct proc_vmstat, thp_fault_alloc),
+	PROC_KV_FIELD("thp_fault_fallback", struct proc_vmstat,
+		      thp_fault_fallback),
+	PROC_KV_FIELD("oom_kill", struct proc_vmstat, oom_kill),
+};
+
+static const struct proc_kv_field proc_self_status_kv[] = {
+	PROC_KV_FIELD("Pid", struct proc_self_status, pid),
+	PROC_KV_FIELD("PPid", struct proc_self_status, ppid),
+	PROC_KV_FIELD("VmPeak", struct proc_self_status, vm_peak),
+	PROC_KV_FIELD("VmSize", struct proc_self_status, vm_size),
+	PROC_KV_FIELD("VmLck", struct proc_self_status, vm_lck),
+	PROC_KV_FIELD("VmPin", struct proc_self_status, vm_pin),
+	PROC_KV_FIELD("VmHWM", struct proc_self_status, vm_hwm),
+	PROC_KV_FIELD("VmRSS", struct proc_self_status, vm_rss),
+	PROC_KV_FIELD("RssAnon", struct proc_self_status, rss_anon),
+	PROC_KV_FIELD("RssFile", struct proc_self_status, rss_file),
+	PROC_KV_FIELD("RssShmem", struct proc_self_status, rss_shmem),
+	PROC_KV_FIELD("VmData", struct proc_self_status, vm_data),
+	PROC_KV_FIELD("VmStk", struct proc_self_status, vm_stk),
+	PROC_KV_FIELD("VmExe", struct proc_self_status, vm_exe),
+	PROC_KV_FIELD("VmLib", struct proc_self_status, vm_lib),
+	PROC_KV_FIELD("VmPTE", struct proc_self_status, vm_pte),
+	PROC_KV_FIELD("VmSwap", struct proc_self_status, vm_swap),
+	PROC_KV_FIELD("HugetlbPages", struct proc_self_status, hugetlb_pages),
+	PROC_KV_FIELD("Threads", struct proc_self_status, threads),
+	PROC_KV_FIELD("voluntary_ctxt_switches", struct proc_self_status,
+		      voluntary_ctxt_switches),
+	PROC_KV_FIELD("nonvoluntary_ctxt_switches", struct proc_self_status,
+		      nonvoluntary_ctxt_switches),
+};
+
+static const struct proc_kv_field proc_smaps_rollup_kv[] = {
+	PROC_KV_FIELD("Rss", struct proc_smaps_rollup, rss),
+	PROC_KV_FIELD("Pss", struct proc_smaps_rollup, pss),
+	PROC_KV_FIELD("Pss_Dirty", struct proc_smaps_rollup, pss_dirty),
+	PROC_KV_FIELD("Pss_Anon", struct proc_smaps_rollup, pss_anon),
+	PROC_KV_FIELD("Pss_File", struct proc_smaps_rollup, pss_file),
+	PROC_KV_FIELD("Pss_Shmem", struct proc_smaps_rollup, pss_shmem),
+	PROC_KV_FIELD("Shared_Clean", struct proc_smaps_rollup, shared_clean),
+	PROC_KV_FIELD("Shared_Dirty", struct proc_smaps_rollup, shared_dirty),
+	PROC_KV_FIELD("Private_Clean", struct proc_smaps_rollup, private_clean),
+	PROC_KV_FIELD("Private_Dirty", struct proc_smaps_rollup, private_dirty),
+	PROC_KV_FIELD("Referenced", struct proc_smaps_rollup, referenced),
+	PROC_KV_FIELD("Anonymous", struct proc_smaps_rollup, anonymous),
+	PROC_KV_FIELD("KSM", struct proc_smaps_rollup, ksm),
+	PROC_KV_FIELD("LazyFree", struct proc_smaps_rollup, lazy_free),
+	PROC_KV_FIELD("AnonHugePages", struct proc_smaps_rollup,
+		      anon_huge_pages),
+	PROC_KV_FIELD("ShmemPmdMapped", struct proc_smaps_rollup,
+		      shmem_pmd_mapped),
+	PROC_KV_FIELD("FilePmdMapped", struct proc_smaps_rollup,
+		      file_pmd_mapped),
+	PROC_KV_FIELD("Shared_Hugetlb", struct proc_smaps_rollup,
+		      shared_hugetlb),
+	PROC_KV_FIELD("Private_Hugetlb", struct proc_smaps_rollup,
+		      private_hugetlb),
+	PROC_KV_FIELD("Swap", struct proc_smaps_rollup, swap),
+	PROC_KV_FIELD("SwapPss", struct proc_smaps_rollup, swap_pss),
+	PROC_KV_FIELD("Locked", struct proc_smaps_rollup, locked),
+};
+
+static const struct proc_kv_field proc_stat_kv[] = {
+	PROC_KV_FIELDN("cpu", struct proc_stat, cpu, 10),
+	PROC_KV_FIELD("intr", struct proc_stat, intr),
+	PROC_KV_FIELD("ctxt", struct proc_stat, ctxt),
+	PROC_KV_FIELD("btime", struct proc_stat, btime),
+	PROC_KV_FIELD("processes", struct proc_stat, processes),
+	PROC_KV_FIELD("procs_running", struct proc_stat, procs_running),
+	PROC_KV_FIELD("procs_blocked", struct proc_stat, procs_blocked),
+	PROC_KV_FIELD("softirq", struct proc_stat, softirq),
+};
+
+int proc_do_read_vmstat(struct proc_buf *pb, struct proc_vmstat *vs)
+{
+	PROC_TRACE_SCOPE();
+
+	return (proc_do_read_kv(pb, PROC_VMSTAT_PATH, proc_vmstat_kv,
+				PROC_KV_NFIELDS(proc_vmstat_kv), vs,
+				sizeof(struct proc_vmstat)));
+}
+
+int proc_do_read_self_status(struct proc_buf *pb,
+			     struct proc_self_status *ss)
+{
+	PROC_TRACE_SCOPE();
+
+	return (proc_do_read_kv(pb, PROC_SELF_STATUS_PATH, proc_self_status_kv,
+				PROC_KV_NFIELDS(proc_self_status_kv), ss,
+				sizeof(struct proc_self_status)));
+}
+
+int proc_do_read_smaps_rollup(struct proc_buf *pb,
+			      struct proc_smaps_rollup *sr)
+{
+	PROC_TRACE_SCOPE();
+
+	return (proc_do_read_kv(pb, PROC_SMAPS_ROLLUP_PATH,
+				proc_smaps_rollup_kv,
+				PROC_KV_NFIELDS(proc_smaps_rollup_kv), sr,
+				sizeof(struct proc_smaps_rollup)));
+}
+
+int proc_do_read_stat(struct proc_buf *pb, struct proc_stat *st)
+{
+	PROC_TRACE_SCOPE();
+
+	return (proc_do_read_kv(pb, PROC_STAT_PATH, proc_stat_kv,
+				PROC_KV_NFIELDS(proc_stat_kv), st,
+				sizeof(struct proc_stat)));
+}
+
+#endif /* PROCFS_IMPL */
+
+#endif /* PROCFS_H */
@@ -0,0 +1,349 @@
+/* Scan every /proc/[pid] in parallel and find the top memory
+   consumers. The ranking only reads statm, which is short and cheap
+   to parse: status is read for the returned entries. Needs -pthread. */
+
+#ifndef PROCSCAN_H
+# define PROCSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "procfs.h"
+
+#ifndef PROCSCAN_ROOT_PATH
+# define PROCSCAN_ROOT_PATH         "/proc"
+#endif
+
+/* Upper bound of the worker pool. */
+#ifndef PROCSCAN_MAX_WORKERS
+# define PROCSCAN_MAX_WORKERS       (8)
+#endif
+
+/* Number of pids a worker claims at once. */
+#ifndef PROCSCAN_BATCH
+# define PROCSCAN_BATCH             (32)
+#endif
+
+/* Constants. Used as return codes. */
+#define PROCSCAN_OPEN_FAILED        (-1)
+#define PROCSCAN_ALLOC_FAILED       (-2)
+
+struct procscan_entry {
+	int pid;
+	/* From statm, in kB. */
+	uint64_t vm_size;
+	uint64_t rss;
+	uint64_t shared;
+	/* From status, in kB. Only filled for the returned entries,
+	   left 0 for kernel threads. */
+	uint64_t vm_hwm;
+	uint64_t rss_anon;
+	uint64_t rss_file;
+	uint64_t rss_shmem;
+	uint64_t vm_swap;
+	/* The Name of status. */
+	char comm[16];
+};
+
+/* Fill out with the (at most) n processes using the most resident
+   memory below root (PROCSCAN_ROOT_PATH if NULL), largest first.
+   nworkers 0 picks one per CPU, up to PROCSCAN_MAX_WORKERS.
+   Returns the number of entries, or a negative constant. */
+extern int procscan_do_top(const char *root, size_t nworkers,
+			   struct procscan_entry *out, size_t n);
+
+#ifdef PROCSCAN_IMPL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+struct procscan_ctx {
+	const char *root;
+	const int *pids;
+	size_t npids;
+	atomic_size_t next;
+	size_t n;
+	uint64_t page_kb;
+};
+
+struct procscan_worker {
+	pthread_t tid;
+	struct procscan_ctx *ctx;
+	/* Min-heap on rss, so the smallest of the top n is at [0]. */
+	struct procscan_entry *heap;
+	size_t nheap;
+};
+
+static void procscan_heap_down(struct procscan_entry *h, size_t n, size_t i)
+{
+	size_t l, m;
+	struct procscan_entry t;
+
+	for (;;) {
+		l = i * 2 + 1;
+		if (l >= n)
+			break;
+		m = l + 1 < n && h[l + 1].rss < h[l].rss ? l + 1 : l;
+		if (h[i].rss <= h[m].rss)
+			break;
+		t = h[i];
+		h[i] = h[m];
+		h[m] = t;
+		i = m;
+	}
+}
+
+static void procscan_heap_push(struct procscan_worker *w,
+			       const struct procscan_entry *e)
+{
+	size_t i, p;
+	struct procscan_entry t;
+
+	if (w->nheap == w->ctx->n) {
+		if (e->rss <= w->heap[0].rss)
+			return;
+		w->heap[0] = *e;
+		procscan_heap_down(w->heap, w->nheap, 0);
+		return;
+	}
+
+	i = w->nheap++;
+	w->heap[i] = *e;
+	while (i > 0) {
+		p = (i - 1) / 2;
+		if (w->heap[p].rss <= w->heap[i].rss)
+			break;
+		t = w->heap[p];
+		w->heap[p] = w->heap[i];
+		w->heap[i] = t;
+		i = p;
+	}
+}
+
+/* "size resident shared text lib data dt", in pages. */
+static int procscan_parse_statm(const char *src, uint64_t *vals, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		vals[i] = 0;
+		for (; *src == ' '; src++)
+			;
+		if (*src < '0' || *src > '9')
+			return (-1);
+		for (; *src >= '0' && *src <= '9'; src++)
+			vals[i] = vals[i] * 10 + (uint64_t)(*src - '0');
+	}
+
+	return (0);
+}
+
+static void *procscan_worker_fn(void *arg)
+{
+	struct procscan_worker *w;
+	struct procscan_ctx *ctx;
+	struct procscan_entry e;
+	struct proc_buf pb;
+	char path[4096];
+	uint64_t vals[3];
+	size_t i, end;
+
+	w = arg;
+	ctx = w->ctx;
+	memset(&pb, '\0', sizeof(pb));
+	memset(&e, '\0', sizeof(e));
+
+	for (;;) {
+		i = atomic_fetch_add(&ctx->next, PROCSCAN_BATCH);
+		if (i >= ctx->npids)
+			break;
+		end = i + PROCSCAN_BATCH < ctx->npids ? i + PROCSCAN_BATCH :
+			ctx->npids;
+
+		for (; i < end; i++) {
+			snprintf(path, sizeof(path), "%s/%d/statm", ctx->root,
+				 ctx->pids[i]);
+			/* The process might be gone by now. */
+			if (proc_do_buf_read(&pb, path) != PROC_KV_ALL_OKAY)
+				continue;
+			if (procscan_parse_statm(pb.data, vals, 3) == -1)
+				continue;
+
+			e.pid = ctx->pids[i];
+			e.vm_size = vals[0] * ctx->page_kb;
+			e.rss = vals[1] * ctx->page_kb;
+			e.shared = vals[2] * ctx->page_kb;
+			procscan_heap_push(w, &e);
+		}
+	}
+
+	proc_do_buf_free(&pb);
+	return (NULL);
+}
+
+static int procscan_cmp_rss(const void *a, const void *b)
+{
+	const struct procscan_entry *x = a, *y = b;
+
+	if (x->rss != y->rss)
+		return (x->rss < y->rss ? 1 : -1);
+	return (x->pid - y->pid);
+}
+
+/* Collect the numeric entries of root. */
+static int procscan_list_pids(const char *root, int **pids, size_t *npids)
+{
+	DIR *d;
+	struct dirent *de;
+	const char *k;
+	int pid, *p;
+	size_t cap;
+
+	if ((d = opendir(root)) == NULL)
+		return (PROCSCAN_OPEN_FAILED);
+
+	*pids = NULL;
+	*npids = 0;
+	cap = 0;
+	while ((de = readdir(d)) != NULL) {
+		pid = 0;
+		for (k = de->d_name; *k >= '0' && *k <= '9'; k++)
+			pid = pid * 10 + (*k - '0');
+		if (*k != '\0' || k == de->d_name)
+			continue;
+
+		if (*npids == cap) {
+			cap = cap == 0 ? 1024 : cap * 2;
+			if ((p = realloc(*pids, cap * sizeof(int))) == NULL) {
+				closedir(d);
+				free(*pids);
+				return (PROCSCAN_ALLOC_FAILED);
+			}
+			*pids = p;
+		}
+		(*pids)[(*npids)++] = pid;
+	}
+
+	closedir(d);
+	return (0);
+}
+
+static const struct proc_kv_field procscan_status_kv[] = {
+	PROC_KV_FIELD("VmHWM", struct procscan_entry, vm_hwm),
+	PROC_KV_FIELD("RssAnon", struct procscan_entry, rss_anon),
+	PROC_KV_FIELD("RssFile", struct procscan_entry, rss_file),
+	PROC_KV_FIELD("RssShmem", struct procscan_entry, rss_shmem),
+	PROC_KV_FIELD("VmSwap", struct procscan_entry, vm_swap),
+};
+
+static void procscan_read_status(const char *root, struct procscan_entry *e,
+				 struct proc_buf *pb)
+{
+	char path[4096];
+	const char *k;
+	size_t len;
+
+	snprintf(path, sizeof(path), "%s/%d/status", root, e->pid);
+	e->comm[0] = '\0';
+	if (proc_do_buf_read(pb, path) != PROC_KV_ALL_OKAY)
+		return;
+
+	/* "Name:\t<comm>" is the first line. */
+	if (strncmp(pb->data, "Name:", 5) == 0) {
+		for (k = pb->data + 5; *k == '\t' || *k == ' '; k++)
+			;
+		len = strcspn(k, "\n");
+		if (len >= sizeof(e->comm))
+			len = sizeof(e->comm) - 1;
+		memcpy(e->comm, k, len);
+		e->comm[len] = '\0';
+	}
+
+	proc_do_parse_kv(pb->data, pb->len, procscan_status_kv,
+			 PROC_KV_NFIELDS(procscan_status_kv), e);
+}
+
+int procscan_do_top(const char *root, size_t nworkers,
+		    struct procscan_entry *out, size_t n)
+{
+	struct procscan_ctx ctx;
+	struct procscan_worker w[PROCSCAN_MAX_WORKERS];
+	struct procscan_entry *all;
+	struct proc_buf pb;
+	int *pids, r;
+	size_t i, nall, nstarted;
+	long ncpu;
+
+	if (n == 0)
+		return (0);
+	if (root == NULL)
+		root = PROCSCAN_ROOT_PATH;
+	if (nworkers == 0) {
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nworkers = ncpu > 0 ? (size_t)ncpu : 1;
+	}
+	if (nworkers > PROCSCAN_MAX_WORKERS)
+		nworkers = PROCSCAN_MAX_WORKERS;
+
+	if ((r = procscan_list_pids(root, &pids, &ctx.npids)) != 0)
+		return (r);
+	ctx.root = root;
+	ctx.pids = pids;
+	ctx.n = n;
+	ctx.page_kb = (uint64_t)sysconf(_SC_PAGESIZE) / 1024;
+	atomic_init(&ctx.next, 0);
+
+	/* One heap per worker, merged once they're done. */
+	if ((all = calloc(nworkers * n, sizeof(struct procscan_entry))) == NULL) {
+		free(pids);
+		return (PROCSCAN_ALLOC_FAILED);
+	}
+
+	for (i = 0; i < nworkers; i++) {
+		w[i].ctx = &ctx;
+		w[i].heap = all + i * n;
+		w[i].nheap = 0;
+	}
+
+	/* The calling thread is the first worker. */
+	nstarted = 1;
+	for (i = 1; i < nworkers; i++, nstarted++) {
+		if (pthread_create(&w[i].tid, NULL, procscan_worker_fn,
+				   &w[i]) != 0)
+			break;
+	}
+	procscan_worker_fn(&w[0]);
+	for (i = 1; i < nstarted; i++)
+		pthread_join(w[i].tid, NULL);
+	free(pids);
+
+	/* Compact the heaps, and sort them. */
+	nall = 0;
+	for (i = 0; i < nstarted; i++) {
+		memmove(all + nall, w[i].heap,
+			w[i].nheap * sizeof(struct procscan_entry));
+		nall += w[i].nheap;
+	}
+	qsort(all, nall, sizeof(struct procscan_entry), procscan_cmp_rss);
+	if (nall > n)
+		nall = n;
+
+	memset(&pb, '\0', sizeof(pb));
+	for (i = 0; i < nall; i++) {
+		out[i] = all[i];
+		procscan_read_status(root, &out[i], &pb);
+	}
+	proc_do_buf_free(&pb);
+	free(all);
+
+	return ((int)nall);
+}
+
+#endif /* PROCSCAN_IMPL */
+
+#endif /* PROCSCAN_H */
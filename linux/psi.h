@@ -0,0 +1,363 @@
+/* Memory pressure notifications through PSI triggers
+   (/proc/pressure/memory). */
+
+#ifndef PSI_H
+# define PSI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <poll.h>
+
+#include "meminfo.h"
+
+#ifndef PROC_PSI_MEMORY_PATH
+# define PROC_PSI_MEMORY_PATH    "/proc/pressure/memory"
+#endif
+
+/* Maximum number of triggers per monitor. */
+#ifndef PSI_MAX_TRIGGERS
+# define PSI_MAX_TRIGGERS        (8)
+#endif
+
+/* Constants. Used as return codes. */
+#define PSI_ALL_OKAY             (0)
+#define PSI_OPEN_FAILED          (-1)
+#define PSI_TOO_MANY_TRIGGERS    (-2)
+#define PSI_POLL_FAILED          (-3)
+#define PSI_TIMEOUT              (-4)
+#define PSI_EVENT_ERROR          (-5)
+#define PSI_PARSE_FAILED         (-6)
+
+/* Kind of stall that a trigger watches. */
+#define PSI_SOME                 (0)
+#define PSI_FULL                 (1)
+
+struct psi_avgs {
+	double avg10;
+	double avg60;
+	double avg300;
+	/* Total stall time, in microseconds. */
+	uint64_t total;
+};
+
+/* Content of the /proc/pressure/memory pseudo file. */
+struct psi_pressure {
+	struct psi_avgs some;
+	struct psi_avgs full;
+};
+
+struct psi_trigger {
+	int kind;
+	uint64_t stall_us;
+	uint64_t window_us;
+	/* Only used when the kernel refused the trigger and
+	   we're emulating it by reading the totals. */
+	int emulated;
+	uint64_t last_total;
+	uint64_t deadline_us;
+};
+
+struct psi_monitor {
+	/* Emulated triggers have their fd set to -1, which
+	   poll(2) ignores. */
+	struct pollfd fds[PSI_MAX_TRIGGERS];
+	struct psi_trigger triggers[PSI_MAX_TRIGGERS];
+	size_t ntriggers;
+};
+
+/* Initialize an empty monitor. */
+extern void psi_do_init(struct psi_monitor *pm);
+/* Register a trigger firing when "kind" stalls exceed stall_us
+   within window_us. Falls back to emulation if the kernel (or a
+   fixture file) doesn't accept the trigger. */
+extern int psi_do_add_trigger(struct psi_monitor *pm, int kind,
+			      uint64_t stall_us, uint64_t window_us);
+/* Wait for a trigger to fire and take a fresh meminfo snapshot.
+   Returns the trigger index, or a negative constant: PSI_PARSE_FAILED
+   if the totals of an emulated trigger couldn't be read. */
+extern int psi_do_wait(struct psi_monitor *pm, int timeout_ms,
+		       struct proc_meminfo *pmi);
+/* Read the current pressure averages. */
+extern int psi_do_read_pressure(struct psi_pressure *pp);
+/* Close all triggers. */
+extern void psi_do_close(struct psi_monitor *pm);
+
+#ifdef PSI_IMPL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/vfs.h>
+
+#ifndef PROC_SUPER_MAGIC
+# define PROC_SUPER_MAGIC    (0x9fa0)
+#endif
+
+static uint64_t psi_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000);
+}
+
+/* Parse "avg10=0.00 avg60=0.00 avg300=0.00 total=0" from a line. */
+static int psi_parse_avgs(const char *line, struct psi_avgs *pa)
+{
+	const char *k;
+
+	if ((k = strstr(line, "avg10=")) == NULL)
+		return (PSI_PARSE_FAILED);
+	pa->avg10 = strtod(k + 6, NULL);
+	if ((k = strstr(line, "avg60=")) == NULL)
+		return (PSI_PARSE_FAILED);
+	pa->avg60 = strtod(k + 6, NULL);
+	if ((k = strstr(line, "avg300=")) == NULL)
+		return (PSI_PARSE_FAILED);
+	pa->avg300 = strtod(k + 7, NULL);
+	if ((k = strstr(line, "total=")) == NULL)
+		return (PSI_PARSE_FAILED);
+	pa->total = strtoull(k + 6, NULL, 10);
+
+	return (PSI_ALL_OKAY);
+}
+
+int psi_do_read_pressure(struct psi_pressure *pp)
+{
+	int fd;
+	char buf[256], *full;
+	ssize_t nbytes_read;
+
+	memset(pp, '\0', sizeof(struct psi_pressure));
+	if ((fd = open(PROC_PSI_MEMORY_PATH, O_RDONLY)) == -1)
+		return (PSI_OPEN_FAILED);
+
+	nbytes_read = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (nbytes_read <= 0)
+		return (PSI_PARSE_FAILED);
+	buf[nbytes_read] = '\0';
+
+	if (strncmp(buf, "some ", 5) != 0)
+		return (PSI_PARSE_FAILED);
+	/* "full" line is missing for the CPU resource on older kernels,
+	   it's always there for memory but don't require it. */
+	if ((full = strstr(buf, "\nfull ")) != NULL) {
+		*full++ = '\0';
+		if (psi_parse_avgs(full, &pp->full) != PSI_ALL_OKAY)
+			return (PSI_PARSE_FAILED);
+	}
+
+	return (psi_parse_avgs(buf, &pp->some));
+}
+
+/* Only procfs files are able to raise POLLPRI. */
+static int psi_is_procfs(int fd)
+{
+	struct statfs sfs;
+
+	if (fstatfs(fd, &sfs) == -1)
+		return (0);
+	return (sfs.f_type == PROC_SUPER_MAGIC);
+}
+
+static int psi_snapshot(struct proc_meminfo *pmi)
+{
+	char *p;
+	int r;
+
+	p = NULL;
+	if ((r = proc_do_init_meminfo(pmi, &p)) != PROC_MEMINFO_ALL_OKAY) {
+		free(p);
+		return (r);
+	}
+
+	proc_do_collect_all(pmi, p);
+	free(p);
+	return (PROC_MEMINFO_ALL_OKAY);
+}
+
+static uint64_t psi_kind_total(const struct psi_pressure *pp, int kind)
+{
+	return (kind == PSI_FULL ? pp->full.total : pp->some.total);
+}
+
+void psi_do_init(struct psi_monitor *pm)
+{
+	memset(pm, '\0', sizeof(struct psi_monitor));
+}
+
+int psi_do_add_trigger(struct psi_monitor *pm, int kind,
+		       uint64_t stall_us, uint64_t window_us)
+{
+	int fd;
+	char buf[64];
+	size_t len;
+	struct psi_trigger *t;
+	struct psi_pressure pp;
+
+	if (pm->ntriggers == PSI_MAX_TRIGGERS)
+		return (PSI_TOO_MANY_TRIGGERS);
+
+	t = &pm->triggers[pm->ntriggers];
+	t->kind = kind;
+	t->stall_us = stall_us;
+	t->window_us = window_us;
+	t->emulated = 0;
+
+	len = (size_t)snprintf(buf, sizeof(buf), "%s %llu %llu",
+			       kind == PSI_FULL ? "full" : "some",
+			       (unsigned long long)stall_us,
+			       (unsigned long long)window_us);
+
+	/* The trigger lives as long as the fd stays open. Writing to
+	   a regular (fixture) file succeeds too, but such a file can
+	   never raise POLLPRI, so emulate in that case as well. */
+	fd = open(PROC_PSI_MEMORY_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd != -1 && psi_is_procfs(fd) &&
+	    write(fd, buf, len + 1) == (ssize_t)(len + 1)) {
+		pm->fds[pm->ntriggers].fd = fd;
+		pm->fds[pm->ntriggers].events = POLLPRI;
+		pm->ntriggers++;
+		return (PSI_ALL_OKAY);
+	}
+	if (fd != -1)
+		close(fd);
+
+	/* Fallback: compare the stall totals once per window. */
+	if (psi_do_read_pressure(&pp) != PSI_ALL_OKAY)
+		return (PSI_OPEN_FAILED);
+
+	t->emulated = 1;
+	t->last_total = psi_kind_total(&pp, kind);
+	t->deadline_us = psi_now_us() + window_us;
+	pm->fds[pm->ntriggers].fd = -1;
+	pm->fds[pm->ntriggers].events = 0;
+	pm->ntriggers++;
+	return (PSI_ALL_OKAY);
+}
+
+/* Check emulated triggers whose window has elapsed, fired is set to
+   the index of the first one that fired, or -1. If the totals can't be
+   read, the windows are restarted so that the caller doesn't spin. */
+static int psi_check_emulated(struct psi_monitor *pm, uint64_t now,
+			      int *fired)
+{
+	size_t i;
+	int have_pp, r;
+	uint64_t total;
+	struct psi_trigger *t;
+	struct psi_pressure pp;
+
+	*fired = -1;
+	have_pp = 0;
+	r = PSI_ALL_OKAY;
+	for (i = 0; i < pm->ntriggers; i++) {
+		t = &pm->triggers[i];
+		if (!t->emulated || now < t->deadline_us)
+			continue;
+		t->deadline_us = now + t->window_us;
+		if (!have_pp) {
+			r = psi_do_read_pressure(&pp);
+			have_pp = 1;
+		}
+		if (r != PSI_ALL_OKAY)
+			continue;
+
+		total = psi_kind_total(&pp, t->kind);
+		if (*fired == -1 && total - t->last_total >= t->stall_us)
+			*fired = (int)i;
+		t->last_total = total;
+	}
+
+	return (r == PSI_ALL_OKAY ? PSI_ALL_OKAY : PSI_PARSE_FAILED);
+}
+
+/* Time until the next emulated trigger has to be checked, in
+   milliseconds, or -1 if there are none. */
+static int psi_next_emulated_ms(const struct psi_monitor *pm, uint64_t now)
+{
+	size_t i;
+	uint64_t next;
+
+	next = UINT64_MAX;
+	for (i = 0; i < pm->ntriggers; i++) {
+		if (pm->triggers[i].emulated &&
+		    pm->triggers[i].deadline_us < next)
+			next = pm->triggers[i].deadline_us;
+	}
+
+	if (next == UINT64_MAX)
+		return (-1);
+	if (next <= now)
+		return (0);
+	/* Round up, so we don't wake up just before the deadline. */
+	return ((int)((next - now + 999) / 1000));
+}
+
+int psi_do_wait(struct psi_monitor *pm, int timeout_ms,
+		struct proc_meminfo *pmi)
+{
+	int r, ms, next_ms, fired;
+	size_t i;
+	uint64_t now, end;
+
+	now = psi_now_us();
+	end = timeout_ms < 0 ? UINT64_MAX : now + (uint64_t)timeout_ms * 1000;
+
+	for (;;) {
+		if (psi_check_emulated(pm, now, &fired) != PSI_ALL_OKAY)
+			return (PSI_PARSE_FAILED);
+		if (fired != -1)
+			break;
+
+		ms = end == UINT64_MAX ? -1 :
+			(end > now ? (int)((end - now + 999) / 1000) : 0);
+		next_ms = psi_next_emulated_ms(pm, now);
+		if (next_ms != -1 && (ms == -1 || next_ms < ms))
+			ms = next_ms;
+
+		r = poll(pm->fds, (nfds_t)pm->ntriggers, ms);
+		if (r == -1)
+			return (PSI_POLL_FAILED);
+
+		for (i = 0; r > 0 && i < pm->ntriggers; i++) {
+			if (pm->fds[i].revents & POLLERR)
+				return (PSI_EVENT_ERROR);
+			if (pm->fds[i].revents & POLLPRI) {
+				fired = (int)i;
+				break;
+			}
+		}
+		if (fired != -1)
+			break;
+
+		now = psi_now_us();
+		if (now >= end && psi_next_emulated_ms(pm, now) != 0)
+			return (PSI_TIMEOUT);
+	}
+
+	/* A failed snapshot leaves pmi zeroed, the event is still
+	   reported. */
+	if (pmi != NULL)
+		psi_snapshot(pmi);
+	return (fired);
+}
+
+void psi_do_close(struct psi_monitor *pm)
+{
+	size_t i;
+
+	for (i = 0; i < pm->ntriggers; i++) {
+		if (pm->fds[i].fd != -1)
+			close(pm->fds[i].fd);
+	}
+	pm->ntriggers = 0;
+}
+
+#endif /* PSI_IMPL */
+
+#endif /* PSI_H */
@@ -0,0 +1,369 @@
+/* Allocation accounting: live nodes, bytes, peak usage and allocation
+   rate per kind of container, plus a leak report for tests.
+
+   Define SLL_ACCT or DLIST_ACCT before including those headers to
+   account their nodes. The hot path only touches counters of the
+   calling thread, the counters of every thread are summed on read.
+   Needs -pthread. */
+#ifndef MEMACCT_H
+# define MEMACCT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+/* Upper bound of the kinds, builtin ones included. */
+#ifndef MEMACCT_MAX_KINDS
+# define MEMACCT_MAX_KINDS    (16)
+#endif
+
+/* Bytes a thread allocates (or frees) before publishing them to the
+   shared peak counters. The peak may be off by this much per
+   thread, the other counters are exact. */
+#ifndef MEMACCT_BATCH
+# define MEMACCT_BATCH        (64 * 1024)
+#endif
+
+/* Builtin kinds. */
+#define MEMACCT_SLL           (0)
+#define MEMACCT_DLIST         (1)
+#define MEMACCT_NBUILTIN      (2)
+
+/* Used as kind, sums every kind. */
+#define MEMACCT_TOTAL         (-1)
+
+struct memacct_kind {
+	const char *name;
+	uint64_t nallocs;
+	uint64_t nfrees;
+	uint64_t bytes_allocated;
+	uint64_t live_nodes;
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+};
+
+struct memacct_stats {
+	uint64_t ts_ns;
+	size_t nkinds;
+	struct memacct_kind kinds[MEMACCT_MAX_KINDS];
+	struct memacct_kind total;
+};
+
+/* Written by its thread only. */
+struct memacct_thread {
+	_Atomic uint64_t nallocs[MEMACCT_MAX_KINDS];
+	_Atomic uint64_t nfrees[MEMACCT_MAX_KINDS];
+	_Atomic uint64_t bytes_in[MEMACCT_MAX_KINDS];
+	_Atomic uint64_t bytes_out[MEMACCT_MAX_KINDS];
+	/* Not published yet. */
+	int64_t pending[MEMACCT_MAX_KINDS];
+	/* Set once the thread exited, the counters are then reused. */
+	atomic_int dead;
+	struct memacct_thread *next;
+};
+
+extern __thread struct memacct_thread *memacct_self;
+
+/* Register a new kind, for pools built on the containers. Returns
+   the kind, or -1 if there are already MEMACCT_MAX_KINDS. */
+extern int memacct_do_register_kind(const char *name);
+/* Slow path of the first allocation of a thread. */
+extern struct memacct_thread *memacct_do_register_thread(void);
+/* Publish the pending bytes of a kind to the peak counters. */
+extern void memacct_do_publish(struct memacct_thread *t, int kind);
+/* Sum the counters of every thread. */
+extern void memacct_do_read(struct memacct_stats *st);
+/* Allocations per second between two reads. */
+extern double memacct_do_alloc_rate(const struct memacct_stats *prev,
+				    const struct memacct_stats *cur,
+				    int kind);
+/* Nodes allocated since before and still alive. */
+extern int64_t memacct_do_leaked(const struct memacct_stats *before,
+				 int kind);
+/* Print the kinds with leaked nodes since before (every live node if
+   NULL). Returns the number of such kinds, 0 if nothing leaked:
+     yassert(memacct_do_report(stderr, &before) == 0); */
+extern int memacct_do_report(FILE *fp, const struct memacct_stats *before);
+/* Print every counter. */
+extern void memacct_do_print(FILE *fp, const struct memacct_stats *st);
+
+static inline void memacct_add(_Atomic uint64_t *c, uint64_t v)
+{
+	/* Single writer, a plain add that readers can't see torn. */
+	atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) +
+			      v, memory_order_relaxed);
+}
+
+static inline void memacct_do_alloc(int kind, size_t size)
+{
+	struct memacct_thread *t;
+
+	if ((t = memacct_self) == NULL &&
+	    (t = memacct_do_register_thread()) == NULL)
+		return;
+
+	memacct_add(&t->nallocs[kind], 1);
+	memacct_add(&t->bytes_in[kind], size);
+	if ((t->pending[kind] += (int64_t)size) >= MEMACCT_BATCH)
+		memacct_do_publish(t, kind);
+}
+
+static inline void memacct_do_free(int kind, size_t size)
+{
+	struct memacct_thread *t;
+
+	if ((t = memacct_self) == NULL &&
+	    (t = memacct_do_register_thread()) == NULL)
+		return;
+
+	memacct_add(&t->nfrees[kind], 1);
+	memacct_add(&t->bytes_out[kind], size);
+	if ((t->pending[kind] -= (int64_t)size) <= -MEMACCT_BATCH)
+		memacct_do_publish(t, kind);
+}
+
+#ifdef MEMACCT_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+__thread struct memacct_thread *memacct_self;
+
+static _Atomic(struct memacct_thread *) memacct_threads;
+static pthread_once_t memacct_once = PTHREAD_ONCE_INIT;
+static pthread_key_t memacct_key;
+
+static const char *memacct_names[MEMACCT_MAX_KINDS] = {
+	[MEMACCT_SLL] = "sll",
+	[MEMACCT_DLIST] = "dlist",
+};
+/* Readers load it with acquire ordering, and then see the names of
+   every kind it counts. */
+static atomic_int memacct_nkinds = MEMACCT_NBUILTIN;
+static pthread_mutex_t memacct_kinds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Published live bytes, and their peak. [MEMACCT_MAX_KINDS] is the
+   total. */
+static _Atomic int64_t memacct_live[MEMACCT_MAX_KINDS + 1];
+static _Atomic int64_t memacct_peak[MEMACCT_MAX_KINDS + 1];
+
+static void memacct_peak_max(_Atomic int64_t *peak, int64_t v)
+{
+	int64_t p;
+
+	p = atomic_load_explicit(peak, memory_order_relaxed);
+	while (v > p && !atomic_compare_exchange_weak(peak, &p, v))
+		;
+}
+
+void memacct_do_publish(struct memacct_thread *t, int kind)
+{
+	int64_t v;
+
+	if (t->pending[kind] == 0)
+		return;
+	v = atomic_fetch_add(&memacct_live[kind], t->pending[kind]) +
+		t->pending[kind];
+	memacct_peak_max(&memacct_peak[kind], v);
+	v = atomic_fetch_add(&memacct_live[MEMACCT_MAX_KINDS],
+			     t->pending[kind]) + t->pending[kind];
+	memacct_peak_max(&memacct_peak[MEMACCT_MAX_KINDS], v);
+	t->pending[kind] = 0;
+}
+
+/* Thread exit. */
+static void memacct_release_thread(void *arg)
+{
+	struct memacct_thread *t = arg;
+	int k;
+
+	for (k = 0; k < MEMACCT_MAX_KINDS; k++)
+		memacct_do_publish(t, k);
+	memacct_self = NULL;
+	atomic_store_explicit(&t->dead, 1, memory_order_release);
+}
+
+static void memacct_init(void)
+{
+	pthread_key_create(&memacct_key, memacct_release_thread);
+}
+
+int memacct_do_register_kind(const char *name)
+{
+	int k;
+
+	/* The name is stored before the kind is published. */
+	pthread_mutex_lock(&memacct_kinds_lock);
+	k = atomic_load_explicit(&memacct_nkinds, memory_order_relaxed);
+	if (k == MEMACCT_MAX_KINDS) {
+		pthread_mutex_unlock(&memacct_kinds_lock);
+		return (-1);
+	}
+	memacct_names[k] = name;
+	atomic_store_explicit(&memacct_nkinds, k + 1, memory_order_release);
+	pthread_mutex_unlock(&memacct_kinds_lock);
+	return (k);
+}
+
+struct memacct_thread *memacct_do_register_thread(void)
+{
+	struct memacct_thread *t, *head;
+	int dead;
+
+	pthread_once(&memacct_once, memacct_init);
+
+	/* Counters are cumulative, those of an exited thread can be
+	   carried on as is. */
+	for (t = atomic_load(&memacct_threads); t != NULL; t = t->next) {
+		dead = 1;
+		if (atomic_compare_exchange_strong(&t->dead, &dead, 0))
+			break;
+	}
+
+	if (t == NULL) {
+		if ((t = calloc(1, sizeof(struct memacct_thread))) == NULL)
+			return (NULL);
+		head = atomic_load(&memacct_threads);
+		do {
+			t->next = head;
+		} while (!atomic_compare_exchange_weak(&memacct_threads,
+						       &head, t));
+	}
+
+	pthread_setspecific(memacct_key, t);
+	memacct_self = t;
+	return (t);
+}
+
+static void memacct_sum(struct memacct_kind *dst, const struct memacct_kind *src)
+{
+	dst->nallocs += src->nallocs;
+	dst->nfrees += src->nfrees;
+	dst->bytes_allocated += src->bytes_allocated;
+	dst->live_nodes += src->live_nodes;
+	dst->live_bytes += src->live_bytes;
+}
+
+void memacct_do_read(struct memacct_stats *st)
+{
+	struct memacct_thread *t;
+	struct memacct_kind *k;
+	struct timespec ts;
+	uint64_t bytes_out;
+	size_t i;
+
+	memset(st, '\0', sizeof(struct memacct_stats));
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	st->ts_ns = (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+	st->nkinds = (size_t)atomic_load_explicit(&memacct_nkinds,
+						  memory_order_acquire);
+
+	for (i = 0; i < st->nkinds; i++) {
+		k = &st->kinds[i];
+		k->name = memacct_names[i];
+		bytes_out = 0;
+		for (t = atomic_load(&memacct_threads); t != NULL; t = t->next) {
+			k->nallocs += atomic_load_explicit(&t->nallocs[i],
+							   memory_order_relaxed);
+			k->nfrees += atomic_load_explicit(&t->nfrees[i],
+							  memory_order_relaxed);
+			k->bytes_allocated += atomic_load_explicit(
+				&t->bytes_in[i], memory_order_relaxed);
+			bytes_out += atomic_load_explicit(&t->bytes_out[i],
+							  memory_order_relaxed);
+		}
+		/* A node might be freed by another thread than the one
+		   that allocated it, only the sums make sense. */
+		k->live_nodes = k->nallocs > k->nfrees ? k->nallocs - k->nfrees : 0;
+		k->live_bytes = k->bytes_allocated > bytes_out ?
+			k->bytes_allocated - bytes_out : 0;
+
+		memacct_peak_max(&memacct_peak[i], (int64_t)k->live_bytes);
+		k->peak_bytes = (uint64_t)atomic_load(&memacct_peak[i]);
+		memacct_sum(&st->total, k);
+	}
+
+	st->total.name = "total";
+	memacct_peak_max(&memacct_peak[MEMACCT_MAX_KINDS],
+			 (int64_t)st->total.live_bytes);
+	st->total.peak_bytes =
+		(uint64_t)atomic_load(&memacct_peak[MEMACCT_MAX_KINDS]);
+}
+
+static const struct memacct_kind *memacct_kind_of(
+	const struct memacct_stats *st, int kind)
+{
+	return (kind == MEMACCT_TOTAL ? &st->total : &st->kinds[kind]);
+}
+
+double memacct_do_alloc_rate(const struct memacct_stats *prev,
+			     const struct memacct_stats *cur, int kind)
+{
+	if (cur->ts_ns <= prev->ts_ns)
+		return (0);
+	return ((double)(memacct_kind_of(cur, kind)->nallocs -
+			 memacct_kind_of(prev, kind)->nallocs) * 1e9 /
+		(double)(cur->ts_ns - prev->ts_ns));
+}
+
+int64_t memacct_do_leaked(const struct memacct_stats *before, int kind)
+{
+	struct memacct_stats now;
+
+	memacct_do_read(&now);
+	return ((int64_t)memacct_kind_of(&now, kind)->live_nodes -
+		(before == NULL ? 0 :
+		 (int64_t)memacct_kind_of(before, kind)->live_nodes));
+}
+
+int memacct_do_report(FILE *fp, const struct memacct_stats *before)
+{
+	struct memacct_stats now;
+	uint64_t nodes, bytes;
+	size_t i;
+	int nleaks;
+
+	memacct_do_read(&now);
+	nleaks = 0;
+	for (i = 0; i < now.nkinds; i++) {
+		nodes = now.kinds[i].live_nodes;
+		bytes = now.kinds[i].live_bytes;
+		if (before != NULL && i < before->nkinds) {
+			nodes -= before->kinds[i].live_nodes;
+			bytes -= before->kinds[i].live_bytes;
+		}
+		if ((int64_t)nodes <= 0)
+			continue;
+
+		fprintf(fp, "memacct: %s leaked %llu nodes (%llu bytes)\n",
+			now.kinds[i].name, (unsigned long long)nodes,
+			(unsigned long long)bytes);
+		nleaks++;
+	}
+
+	return (nleaks);
+}
+
+void memacct_do_print(FILE *fp, const struct memacct_stats *st)
+{
+	const struct memacct_kind *k;
+	size_t i;
+
+	for (i = 0; i <= st->nkinds; i++) {
+		k = i == st->nkinds ? &st->total : &st->kinds[i];
+		fprintf(fp, "%-12s live %llu nodes, %llu bytes (peak %llu), "
+			"%llu allocs, %llu frees\n", k->name,
+			(unsigned long long)k->live_nodes,
+			(unsigned long long)k->live_bytes,
+			(unsigned long long)k->peak_bytes,
+			(unsigned long long)k->nallocs,
+			(unsigned long long)k->nfrees);
+	}
+}
+
+#endif /* MEMACCT_IMPL */
+
+#endif /* MEMACCT_H */
@@ -8,6 +8,44 @@
 # define SLL_DATA_TYPE    void
 #endif
 
+/* Trace the sll_do_* functions, see trace.h. */
+#ifdef SLL_TRACE
+# include "trace.h"
+# define SLL_TRACE_SCOPE()    TRACE_SCOPE(__func__)
+#else
+# define SLL_TRACE_SCOPE()
+#endif
+
+/* Account the nodes, see memacct.h. */
+#ifdef SLL_ACCT
+# include "memacct.h"
+# define SLL_ACCT_ALLOC(size)    memacct_do_alloc(MEMACCT_SLL, size)
+# define SLL_ACCT_FREE(size)     memacct_do_free(MEMACCT_SLL, size)
+#else
+# define SLL_ACCT_ALLOC(size)    do { } while (0)
+# define SLL_ACCT_FREE(size)     do { } while (0)
+#endif
+
+/* Node allocator, each macro can be overridden on its own. With
+   SLL_ARENA the nodes come from the thread's arena (see arena.h):
+   freeing a node does nothing, the list goes away with
+   arena_do_rewind() or arena_do_reset(). */
+#if defined (SLL_ARENA)
+# include "arena.h"
+# ifndef SLL_NODE_MALLOC
+#  define SLL_NODE_MALLOC(size)    arena_do_self_alloc(size)
+# endif
+# ifndef SLL_NODE_FREE
+#  define SLL_NODE_FREE(node)      do { } while (0)
+# endif
+#endif
+#ifndef SLL_NODE_MALLOC
+# define SLL_NODE_MALLOC(size)    malloc(size)
+#endif
+#ifndef SLL_NODE_FREE
+# define SLL_NODE_FREE(node)      free(node)
+#endif
+
 struct sll_node {
 	SLL_DATA_TYPE *data;
 	struct sll_node *next;
@@ -86,19 +124,27 @@ static struct sll_node *sll_create_node(const SLL_DATA_TYPE *data)
 {
 	struct sll_node *node;
 
-	node = malloc(sizeof(struct sll_node));
+	node = SLL_NODE_MALLOC(sizeof(struct sll_node));
 	if (node == NULL)
 	        return (NULL);
 
+	SLL_ACCT_ALLOC(sizeof(struct sll_node));
 	node->data = (void *)data;
 	node->next = NULL;
 	return (node);
 }
 
+static void sll_free_node(struct sll_node *node)
+{
+	SLL_ACCT_FREE(sizeof(struct sll_node));
+	SLL_NODE_FREE(node);
+}
+
 struct sll_node *sll_do_push_back(struct sll_node *head,
 				  const SLL_DATA_TYPE *data)
 {
 	struct sll_node *t, *new_node;
+	SLL_TRACE_SCOPE();
 
 	if ((new_node = sll_create_node(data)) == NULL)
 		return (NULL);
@@ -121,6 +167,7 @@ struct sll_node *sll_do_push_front(struct sll_node *head,
 				   const SLL_DATA_TYPE *data)
 {
         struct sll_node *nn;
+	SLL_TRACE_SCOPE();
 
 	nn = sll_create_node(data);
         nn->next = head;
@@ -132,6 +179,7 @@ struct sll_node *sll_do_push_at(struct sll_node *head,
 				const SLL_DATA_TYPE *data, size_t pos)
 {
 	struct sll_node *t, *nn;
+	SLL_TRACE_SCOPE();
 
 	if (pos == 0)
 		return (sll_do_push_front(head, data));
@@ -153,23 +201,25 @@ struct sll_node *sll_do_push_at(struct sll_node *head,
 struct sll_node *sll_do_remove_first(struct sll_node *head)
 {
 	struct sll_node *t;
+	SLL_TRACE_SCOPE();
 
 	if (head == NULL)
 		return (NULL);
 	t = head;
         head = head->next;
-	free(t);
+	sll_free_node(t);
         return (head);
 }
 
 struct sll_node *sll_do_remove_last(struct sll_node *head)
 {
         struct sll_node *t;
+	SLL_TRACE_SCOPE();
 
 	if (head == NULL)
 		return (NULL);
 	if (head->next == NULL) {
-		free(head);
+		sll_free_node(head);
 		return (NULL);
 	}
 
@@ -179,7 +229,7 @@ struct sll_node *sll_do_remove_last(struct sll_node *head)
 		t = t->next;
 
 	/* t->next is the last node. */
-        free(t->next);
+        sll_free_node(t->next);
 	t->next = NULL;
         return (head);
 }
@@ -187,6 +237,7 @@ struct sll_node *sll_do_remove_last(struct sll_node *head)
 struct sll_node *sll_do_remove_at(struct sll_node *head, size_t pos)
 {
 	struct sll_node *t, *new_next;
+	SLL_TRACE_SCOPE();
 
 	if (head == NULL)
 		return (NULL);
@@ -199,13 +250,14 @@ struct sll_node *sll_do_remove_at(struct sll_node *head, size_t pos)
 
         new_next = t->next;
         t->next = t->next->next;
-	free(new_next);
+	sll_free_node(new_next);
 	return (head);
 }
 
 struct sll_node *sll_do_remove_until(struct sll_node *head, size_t till)
 {
 	struct sll_node *t;
+	SLL_TRACE_SCOPE();
 
 	if (head == NULL)
 		return (NULL);
@@ -214,7 +266,7 @@ struct sll_node *sll_do_remove_until(struct sll_node *head, size_t till)
 		t = head;
 		--till;
 		head = head->next;
-		free(t);
+		sll_free_node(t);
 	}
 	return (head);
 }
@@ -222,6 +274,7 @@ struct sll_node *sll_do_remove_until(struct sll_node *head, size_t till)
 struct sll_node *sll_do_reverse_list(struct sll_node *head)
 {
 	struct sll_node *t, *prev, *nn;
+	SLL_TRACE_SCOPE();
 
 	t = head;
 	prev = NULL;
@@ -237,6 +290,8 @@ struct sll_node *sll_do_reverse_list(struct sll_node *head)
 
 int sll_do_is_empty(struct sll_node *head)
 {
+	SLL_TRACE_SCOPE();
+
 	if (head == NULL)
 		return (1);
 	return (0);
@@ -246,6 +301,7 @@ size_t sll_do_count_lists(struct sll_node *head)
 {
 	struct sll_node *t;
 	size_t ncount;
+	SLL_TRACE_SCOPE();
 
 	if (head == NULL)
 		return (0);
@@ -263,30 +319,28 @@ size_t sll_do_count_lists(struct sll_node *head)
 void sll_do_free(struct sll_node *head)
 {
 	struct sll_node *t, *x;
+	SLL_TRACE_SCOPE();
 
 	t = head;
-	while (t->next != NULL) {
+	while (t != NULL) {
 		x = t;
 	        t = t->next;
-		free(x);
+		sll_free_node(x);
 	}
-
-	free(t);
 }
 
 void sll_do_free_data_node(struct sll_node *head)
 {
         struct sll_node *t, *node;
+	SLL_TRACE_SCOPE();
 
 	t = head;
-	while (t->next != NULL) {
+	while (t != NULL) {
 		node = t;
 		free(t->data);
 		t = t->next;
-		free(node);
+		sll_free_node(node);
 	}
-
-	free(t);
 }
 
 #endif /* SLL_IMPL */
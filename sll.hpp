@@ -0,0 +1,382 @@
+/* Singly linked list, C++ front-end of sll.h. Elements are stored in
+   the nodes, nodes come from an allocator, and the iterators are
+   forward iterators so <algorithm> works. Needs C++17. */
+
+#ifndef SLL_HPP
+# define SLL_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace ds {
+
+template <class T, class Alloc = std::allocator<T>>
+class sll {
+	struct node;
+	using node_alloc = typename std::allocator_traits<Alloc>::
+		template rebind_alloc<node>;
+	using node_traits = std::allocator_traits<node_alloc>;
+	/* Whatever the allocator hands out, e.g. an offset pointer for
+	   nodes in shared memory. */
+	using node_ptr = typename node_traits::pointer;
+
+	struct node {
+		node_ptr next;
+		T data;
+
+		template <class... Args>
+		explicit node(node_ptr n, Args&&... args)
+			: next(n), data(std::forward<Args>(args)...) {}
+	};
+
+public:
+	using value_type = T;
+	using allocator_type = Alloc;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = T &;
+	using const_reference = const T &;
+	using pointer = typename std::allocator_traits<Alloc>::pointer;
+	using const_pointer =
+		typename std::allocator_traits<Alloc>::const_pointer;
+
+	template <bool Const>
+	class basic_iterator {
+		friend class sll;
+		node_ptr n_ = nullptr;
+
+		explicit basic_iterator(node_ptr n) noexcept : n_(n) {}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<Const, const T *, T *>;
+		using reference = std::conditional_t<Const, const T &, T &>;
+
+		basic_iterator() noexcept = default;
+		/* iterator to const_iterator. */
+		template <bool C = Const, class = std::enable_if_t<C>>
+		basic_iterator(const basic_iterator<false> &it) noexcept
+			: n_(it.n_) {}
+
+		reference operator*() const noexcept { return (n_->data); }
+		pointer operator->() const noexcept
+		{
+			return (std::addressof(n_->data));
+		}
+		basic_iterator &operator++() noexcept
+		{
+			n_ = n_->next;
+			return (*this);
+		}
+		basic_iterator operator++(int) noexcept
+		{
+			basic_iterator t = *this;
+
+			n_ = n_->next;
+			return (t);
+		}
+		friend bool operator==(basic_iterator a, basic_iterator b) noexcept
+		{
+			return (a.n_ == b.n_);
+		}
+		friend bool operator!=(basic_iterator a, basic_iterator b) noexcept
+		{
+			return (a.n_ != b.n_);
+		}
+	};
+
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+	sll() noexcept(noexcept(Alloc())) : sll(Alloc()) {}
+	explicit sll(const Alloc &a) noexcept : alloc_(a) {}
+	sll(std::initializer_list<T> il, const Alloc &a = Alloc())
+		: sll(il.begin(), il.end(), a) {}
+	template <class InputIt,
+		  class = typename std::iterator_traits<InputIt>::iterator_category>
+	sll(InputIt first, InputIt last, const Alloc &a = Alloc()) : alloc_(a)
+	{
+		for (; first != last; ++first)
+			emplace_back(*first);
+	}
+	sll(const sll &o)
+		: alloc_(node_traits::select_on_container_copy_construction(
+				 o.alloc_))
+	{
+		for (const T &v : o)
+			emplace_back(v);
+	}
+	sll(sll &&o) noexcept
+		: head_(std::exchange(o.head_, nullptr)),
+		  tail_(std::exchange(o.tail_, nullptr)),
+		  size_(std::exchange(o.size_, 0)), alloc_(std::move(o.alloc_)) {}
+	~sll() { clear(); }
+
+	sll &operator=(const sll &o)
+	{
+		if (this == &o)
+			return (*this);
+		clear();
+		if constexpr (node_traits::propagate_on_container_copy_assignment::value)
+			alloc_ = o.alloc_;
+		for (const T &v : o)
+			emplace_back(v);
+		return (*this);
+	}
+	sll &operator=(sll &&o) noexcept(
+		node_traits::propagate_on_container_move_assignment::value ||
+		node_traits::is_always_equal::value)
+	{
+		if (this == &o)
+			return (*this);
+		clear();
+		if constexpr (node_traits::propagate_on_container_move_assignment::value) {
+			alloc_ = std::move(o.alloc_);
+		} else if (!(alloc_ == o.alloc_)) {
+			/* Nodes can't change hands, move the elements. */
+			for (T &v : o)
+				emplace_back(std::move(v));
+			o.clear();
+			return (*this);
+		}
+		head_ = std::exchange(o.head_, nullptr);
+		tail_ = std::exchange(o.tail_, nullptr);
+		size_ = std::exchange(o.size_, 0);
+		return (*this);
+	}
+
+	allocator_type get_allocator() const { return (Alloc(alloc_)); }
+
+	iterator begin() noexcept { return (iterator(head_)); }
+	iterator end() noexcept { return (iterator(nullptr)); }
+	const_iterator begin() const noexcept { return (const_iterator(head_)); }
+	const_iterator end() const noexcept { return (const_iterator(nullptr)); }
+	const_iterator cbegin() const noexcept { return (begin()); }
+	const_iterator cend() const noexcept { return (end()); }
+
+	/* sll_do_is_empty(), sll_do_count_lists() (in O(1)). */
+	bool empty() const noexcept { return (head_ == nullptr); }
+	size_type size() const noexcept { return (size_); }
+
+	reference front() { return (head_->data); }
+	const_reference front() const { return (head_->data); }
+	reference back() { return (tail_->data); }
+	const_reference back() const { return (tail_->data); }
+
+	/* sll_do_push_front(). */
+	void push_front(const T &v) { emplace_front(v); }
+	void push_front(T &&v) { emplace_front(std::move(v)); }
+	template <class... Args>
+	reference emplace_front(Args&&... args)
+	{
+		node_ptr n = make_node(head_, std::forward<Args>(args)...);
+
+		if (head_ == nullptr)
+			tail_ = n;
+		head_ = n;
+		size_++;
+		return (n->data);
+	}
+
+	/* sll_do_push_back(), in O(1) as the tail is kept. */
+	void push_back(const T &v) { emplace_back(v); }
+	void push_back(T &&v) { emplace_back(std::move(v)); }
+	template <class... Args>
+	reference emplace_back(Args&&... args)
+	{
+		node_ptr n = make_node(nullptr, std::forward<Args>(args)...);
+
+		if (tail_ == nullptr)
+			head_ = n;
+		else
+			tail_->next = n;
+		tail_ = n;
+		size_++;
+		return (n->data);
+	}
+
+	/* sll_do_push_at(), appends if pos is past the end. */
+	iterator insert_at(size_type pos, const T &v)
+	{
+		return (emplace_at(pos, v));
+	}
+	iterator insert_at(size_type pos, T &&v)
+	{
+		return (emplace_at(pos, std::move(v)));
+	}
+	template <class... Args>
+	iterator emplace_at(size_type pos, Args&&... args)
+	{
+		node_ptr t, n;
+
+		if (pos == 0 || head_ == nullptr) {
+			emplace_front(std::forward<Args>(args)...);
+			return (begin());
+		}
+		if (pos >= size_) {
+			emplace_back(std::forward<Args>(args)...);
+			return (iterator(tail_));
+		}
+
+		for (t = head_; --pos > 0; t = t->next)
+			;
+		n = make_node(t->next, std::forward<Args>(args)...);
+		t->next = n;
+		size_++;
+		return (iterator(n));
+	}
+
+	/* sll_do_remove_first(). */
+	void pop_front()
+	{
+		node_ptr t = head_;
+
+		if (t == nullptr)
+			return;
+		if ((head_ = t->next) == nullptr)
+			tail_ = nullptr;
+		size_--;
+		drop_node(t);
+	}
+
+	/* sll_do_remove_until(), removes the first n elements. */
+	void pop_front_n(size_type n)
+	{
+		while (n-- > 0 && head_ != nullptr)
+			pop_front();
+	}
+
+	/* sll_do_remove_last(), in O(n). */
+	void pop_back()
+	{
+		node_ptr t;
+
+		if (head_ == nullptr || head_->next == nullptr) {
+			pop_front();
+			return;
+		}
+		for (t = head_; t->next->next != nullptr; t = t->next)
+			;
+		drop_node(t->next);
+		t->next = nullptr;
+		tail_ = t;
+		size_--;
+	}
+
+	/* sll_do_remove_at(). */
+	void erase_at(size_type pos)
+	{
+		node_ptr t, x;
+
+		if (pos >= size_)
+			return;
+		if (pos == 0) {
+			pop_front();
+			return;
+		}
+
+		for (t = head_; --pos > 0; t = t->next)
+			;
+		x = t->next;
+		if ((t->next = x->next) == nullptr)
+			tail_ = t;
+		size_--;
+		drop_node(x);
+	}
+
+	/* sll_do_reverse_list(). */
+	void reverse() noexcept
+	{
+		node_ptr t, prev, nn;
+
+		tail_ = head_;
+		for (t = head_, prev = nullptr; t != nullptr; t = nn) {
+			nn = t->next;
+			t->next = prev;
+			prev = t;
+		}
+		head_ = prev;
+	}
+
+	/* sll_do_free(). */
+	void clear() noexcept
+	{
+		node_ptr t, x;
+
+		for (t = head_; t != nullptr; ) {
+			x = t;
+			t = t->next;
+			drop_node(x);
+		}
+		head_ = tail_ = nullptr;
+		size_ = 0;
+	}
+
+	void swap(sll &o) noexcept
+	{
+		using std::swap;
+
+		swap(head_, o.head_);
+		swap(tail_, o.tail_);
+		swap(size_, o.size_);
+		if constexpr (node_traits::propagate_on_container_swap::value)
+			swap(alloc_, o.alloc_);
+	}
+
+	friend bool operator==(const sll &a, const sll &b)
+	{
+		const_iterator x, y;
+
+		if (a.size_ != b.size_)
+			return (false);
+		for (x = a.begin(), y = b.begin(); x != a.end(); ++x, ++y) {
+			if (!(*x == *y))
+				return (false);
+		}
+		return (true);
+	}
+	friend bool operator!=(const sll &a, const sll &b) { return (!(a == b)); }
+
+private:
+	template <class... Args>
+	node_ptr make_node(node_ptr next, Args&&... args)
+	{
+		node_ptr n = node_traits::allocate(alloc_, 1);
+
+		try {
+			node_traits::construct(alloc_, std::addressof(*n), next,
+					       std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(alloc_, n, 1);
+			throw;
+		}
+		return (n);
+	}
+
+	void drop_node(node_ptr n) noexcept
+	{
+		node_traits::destroy(alloc_, std::addressof(*n));
+		node_traits::deallocate(alloc_, n, 1);
+	}
+
+	node_ptr head_ = nullptr;
+	node_ptr tail_ = nullptr;
+	size_type size_ = 0;
+	node_alloc alloc_;
+};
+
+template <class T, class Alloc>
+void swap(sll<T, Alloc> &a, sll<T, Alloc> &b) noexcept
+{
+	a.swap(b);
+}
+
+} /* namespace ds */
+
+#endif /* SLL_HPP */
@@ -0,0 +1,563 @@
+/* Flat snapshots of sll, dlist and ss contents, to restart without
+   rebuilding them. A snapshot is a header followed by one record per
+   element, records link to each other by their offset in the file, so
+   it can be mapped anywhere and walked in place:
+     struct snap s;
+     const struct snap_rec *r;
+
+     if (snap_do_open(&s, "nodes.snap", 0) == SNAP_ALL_OKAY) {
+	     SNAP_DO_FOREACH(&s, r)
+		     use(snap_do_data(r), r->len);
+	     snap_do_close(&s);
+     }
+   Elements are copied as bytes, so they can't hold pointers. The file
+   is in native byte order.
+
+   With 4M elements of 32 bytes (224 MB, in the page cache), opening
+   takes 59-62 ms with the checksum and 0.1 ms without, walking 56 ms
+   and thawing into a dlist 190 ms, against 250 ms to malloc() the
+   same dlist node by node (300-375 ms in a fresh process), see
+   bench/bench_snap.c. */
+
+#ifndef SNAP_H
+# define SNAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The containers are only needed by the implementation: ss.h defines
+   its functions in every file that includes it. */
+struct sll_node;
+struct dlist;
+struct ss;
+
+/* "DSSNAP01", in native byte order. */
+#define SNAP_MAGIC           (0x31305041534e5344ULL)
+#define SNAP_VERSION         (2)
+
+/* Allocation of snap_do_thaw_*(), each macro can be overridden on
+   its own but they must match. */
+#ifndef SNAP_MALLOC
+# define SNAP_MALLOC(size)    malloc(size)
+#endif
+#ifndef SNAP_FREE
+# define SNAP_FREE(ptr)       free(ptr)
+#endif
+
+/* Constants. Used as return codes, the first ones share their
+   values with PROC_KV_*. */
+#define SNAP_ALL_OKAY        (0)
+#define SNAP_OPEN_FAILED     (-1)
+#define SNAP_ALLOC_FAILED    (-2)
+#define SNAP_READ_FAILED     (-3)
+#define SNAP_WRITE_FAILED    (-4)
+#define SNAP_BAD_FORMAT      (-5)
+#define SNAP_BAD_CHECKSUM    (-6)
+#define SNAP_TOO_BIG         (-7)
+
+/* Kind of container a snapshot was taken of. */
+#define SNAP_SLL             (1)
+#define SNAP_DLIST           (2)
+#define SNAP_SS              (3)
+
+/* Flags of snap_do_open(). */
+#define SNAP_NO_VERIFY       (1 << 0)
+
+/* len of a NULL element. */
+#define SNAP_NULL            (UINT64_MAX)
+
+struct snap_hdr {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t kind;
+	uint64_t count;
+	/* Of the whole file. */
+	uint64_t size;
+	/* Sum of the element sizes rounded up to 8, for thawing. */
+	uint64_t data_size;
+	/* Offsets of the first and last records, 0 if empty. */
+	uint64_t first;
+	uint64_t last;
+	/* FNV-1a over the 64-bit words of the records, then of the
+	   header with this field zeroed. */
+	uint64_t checksum;
+};
+
+/* Followed by len bytes of data, padded to 8. */
+struct snap_rec {
+	/* 0 at either end. */
+	uint64_t next;
+	uint64_t prev;
+	uint64_t len;
+};
+
+struct snap {
+	const char *base;
+	size_t size;
+	const struct snap_hdr *hdr;
+};
+
+/* Number of bytes of an element. */
+typedef size_t (*snap_size_fn)(const void *data);
+
+/* Write a snapshot of a container to path, through a temporary file
+   renamed once complete. Elements are elem_size bytes long, or
+   size_fn(data) if size_fn isn't NULL. */
+extern int snap_do_write_sll(const char *path, const struct sll_node *head,
+			     size_t elem_size, snap_size_fn size_fn);
+extern int snap_do_write_dlist(const char *path, const struct dlist *head,
+			       size_t elem_size, snap_size_fn size_fn);
+extern int snap_do_write_ss(const char *path, const struct ss *ss,
+			    size_t elem_size, snap_size_fn size_fn);
+/* Map a snapshot read-only. The checksum is checked unless flags has
+   SNAP_NO_VERIFY, the header fields always are. */
+extern int snap_do_open(struct snap *s, const char *path, int flags);
+extern void snap_do_close(struct snap *s);
+/* Copy a snapshot, of any kind, into a mutable container with a single
+   SNAP_MALLOC(), stored in block: the caller frees it at once with
+   SNAP_FREE(block), nothing is allocated on failure. The nodes may be
+   relinked and the data changed, but they mustn't be freed one by
+   one: remove them with SLL_ARENA or DLIST_ARENA defined, see
+   arena.h. */
+extern int snap_do_thaw_sll(const struct snap *s, struct sll_node **head,
+			    void **block);
+extern int snap_do_thaw_dlist(const struct snap *s, struct dlist **head,
+			      void **block);
+/* SNAP_TOO_BIG if there are more than MAX_STACK_SIZE elements. */
+extern int snap_do_thaw_ss(const struct snap *s, struct ss *ss, void **block);
+/* size_fn of C strings. */
+extern size_t snap_do_size_str(const void *data);
+
+static inline const struct snap_rec *snap_do_rec(const struct snap *s,
+						 uint64_t off)
+{
+	if (off < sizeof(struct snap_hdr) || off % 8 != 0 ||
+	    off > s->size - sizeof(struct snap_rec))
+		return (NULL);
+	return ((const struct snap_rec *)(s->base + off));
+}
+
+static inline const struct snap_rec *snap_do_first(const struct snap *s)
+{
+	return (snap_do_rec(s, s->hdr->first));
+}
+
+static inline const struct snap_rec *snap_do_last(const struct snap *s)
+{
+	return (snap_do_rec(s, s->hdr->last));
+}
+
+static inline const struct snap_rec *snap_do_next(const struct snap *s,
+						  const struct snap_rec *r)
+{
+	return (snap_do_rec(s, r->next));
+}
+
+static inline const struct snap_rec *snap_do_prev(const struct snap *s,
+						  const struct snap_rec *r)
+{
+	return (snap_do_rec(s, r->prev));
+}
+
+/* Aligned on 8 bytes, NULL for a NULL element. */
+static inline const void *snap_do_data(const struct snap_rec *r)
+{
+	return (r->len == SNAP_NULL ? NULL : (const void *)(r + 1));
+}
+
+#define SNAP_DO_FOREACH(s, r)					\
+	for (r = snap_do_first(s); r != NULL; r = snap_do_next(s, r))
+#define SNAP_DO_FOREACH_BACKWARD(s, r)				\
+	for (r = snap_do_last(s); r != NULL; r = snap_do_prev(s, r))
+#define SNAP_DO_COUNT(s)    ((size_t)(s)->hdr->count)
+
+#ifdef SNAP_IMPL
+
+#include "sll.h"
+#include "dlist.h"
+#include "ss.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SNAP_PAD(n)    (((n) + 7) & ~(uint64_t)7)
+
+/* Walks any of the containers, from the front. */
+struct snap_iter {
+	int kind;
+	const void *node;
+	const struct ss *ss;
+	size_t idx;
+};
+
+static int snap_iter_next(struct snap_iter *it, const void **data)
+{
+	const struct sll_node *sn;
+	const struct dlist *dn;
+
+	switch (it->kind) {
+	case SNAP_SLL:
+		if ((sn = it->node) == NULL)
+			return (0);
+		*data = sn->data;
+		it->node = sn->next;
+		return (1);
+	case SNAP_DLIST:
+		if ((dn = it->node) == NULL)
+			return (0);
+		*data = dn->data;
+		it->node = dn->next;
+		return (1);
+	default:
+		if (it->idx == it->ss->elem_idx)
+			return (0);
+		*data = it->ss->p[it->idx++];
+		return (1);
+	}
+}
+
+static uint64_t snap_fnv(uint64_t h, const void *buf, size_t len)
+{
+	const unsigned char *p;
+	uint64_t w;
+
+	/* len is a multiple of 8. */
+	for (p = buf; len > 0; p += 8, len -= 8) {
+		memcpy(&w, p, 8);
+		h ^= w;
+		h *= 0x100000001b3ULL;
+	}
+	return (h);
+}
+
+static int snap_write(const char *path, struct snap_iter *it,
+		      size_t elem_size, snap_size_fn size_fn)
+{
+	struct snap_hdr hdr;
+	struct snap_rec *r;
+	const void *data;
+	char *tmp, *buf;
+	size_t cap, len, n;
+	uint64_t off, h;
+	FILE *fp;
+	int more, ret;
+
+	if ((tmp = malloc(strlen(path) + sizeof(".tmp"))) == NULL)
+		return (SNAP_ALLOC_FAILED);
+	strcpy(tmp, path);
+	strcat(tmp, ".tmp");
+	if ((fp = fopen(tmp, "wb")) == NULL) {
+		free(tmp);
+		return (SNAP_OPEN_FAILED);
+	}
+
+	memset(&hdr, '\0', sizeof(hdr));
+	hdr.magic = SNAP_MAGIC;
+	hdr.version = SNAP_VERSION;
+	hdr.kind = (uint32_t)it->kind;
+	hdr.checksum = 0xcbf29ce484222325ULL;
+	off = sizeof(hdr);
+	buf = NULL;
+	cap = 0;
+	ret = SNAP_WRITE_FAILED;
+	/* Filled in at the end. */
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		goto out;
+
+	more = snap_iter_next(it, &data);
+	while (more) {
+		len = data == NULL ? 0 : size_fn != NULL ? size_fn(data) :
+			elem_size;
+		n = sizeof(struct snap_rec) + SNAP_PAD(len);
+		if (n > cap) {
+			free(buf);
+			cap = n * 2;
+			if ((buf = calloc(1, cap)) == NULL) {
+				ret = SNAP_ALLOC_FAILED;
+				goto out;
+			}
+		}
+
+		r = (struct snap_rec *)buf;
+		r->len = data == NULL ? SNAP_NULL : len;
+		if (len > 0)
+			memcpy(r + 1, data, len);
+		memset((char *)(r + 1) + len, '\0', SNAP_PAD(len) - len);
+		/* Records are laid out in order. */
+		more = snap_iter_next(it, &data);
+		r->next = more ? off + n : 0;
+		r->prev = hdr.last;
+		hdr.checksum = snap_fnv(hdr.checksum, buf, n);
+		if (fwrite(buf, n, 1, fp) != 1)
+			goto out;
+
+		if (hdr.first == 0)
+			hdr.first = off;
+		hdr.last = off;
+		hdr.count++;
+		hdr.data_size += SNAP_PAD(len);
+		off += n;
+	}
+
+	hdr.size = off;
+	/* The header goes last, with the checksum zeroed. */
+	h = hdr.checksum;
+	hdr.checksum = 0;
+	hdr.checksum = snap_fnv(h, &hdr, sizeof(hdr));
+	if (fseek(fp, 0, SEEK_SET) == -1 ||
+	    fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fflush(fp) == EOF ||
+	    fsync(fileno(fp)) == -1)
+		goto out;
+	ret = SNAP_ALL_OKAY;
+
+out:
+	free(buf);
+	if (fclose(fp) == EOF && ret == SNAP_ALL_OKAY)
+		ret = SNAP_WRITE_FAILED;
+	if (ret == SNAP_ALL_OKAY && rename(tmp, path) == -1)
+		ret = SNAP_WRITE_FAILED;
+	if (ret != SNAP_ALL_OKAY)
+		unlink(tmp);
+	free(tmp);
+	return (ret);
+}
+
+int snap_do_write_sll(const char *path, const struct sll_node *head,
+		      size_t elem_size, snap_size_fn size_fn)
+{
+	struct snap_iter it;
+
+	memset(&it, '\0', sizeof(it));
+	it.kind = SNAP_SLL;
+	it.node = head;
+	return (snap_write(path, &it, elem_size, size_fn));
+}
+
+int snap_do_write_dlist(const char *path, const struct dlist *head,
+			size_t elem_size, snap_size_fn size_fn)
+{
+	struct snap_iter it;
+
+	memset(&it, '\0', sizeof(it));
+	it.kind = SNAP_DLIST;
+	it.node = head;
+	return (snap_write(path, &it, elem_size, size_fn));
+}
+
+int snap_do_write_ss(const char *path, const struct ss *ss,
+		     size_t elem_size, snap_size_fn size_fn)
+{
+	struct snap_iter it;
+
+	memset(&it, '\0', sizeof(it));
+	it.kind = SNAP_SS;
+	it.ss = ss;
+	return (snap_write(path, &it, elem_size, size_fn));
+}
+
+/* The offsets of the header point inside the file. */
+static int snap_check_hdr(const struct snap_hdr *h, size_t size)
+{
+	if (size < sizeof(struct snap_hdr) || size % 8 != 0 ||
+	    h->magic != SNAP_MAGIC ||
+	    h->version != SNAP_VERSION || h->size != size)
+		return (SNAP_BAD_FORMAT);
+	if (h->kind != SNAP_SLL && h->kind != SNAP_DLIST && h->kind != SNAP_SS)
+		return (SNAP_BAD_FORMAT);
+	if ((h->first == 0) != (h->count == 0) ||
+	    (h->last == 0) != (h->count == 0))
+		return (SNAP_BAD_FORMAT);
+	if (h->count != 0 && (h->first % 8 != 0 || h->last % 8 != 0 ||
+			      h->first < sizeof(struct snap_hdr) ||
+			      h->last < sizeof(struct snap_hdr) ||
+			      h->first > size - sizeof(struct snap_rec) ||
+			      h->last > size - sizeof(struct snap_rec)))
+		return (SNAP_BAD_FORMAT);
+	if (h->data_size > size)
+		return (SNAP_BAD_FORMAT);
+	return (SNAP_ALL_OKAY);
+}
+
+int snap_do_open(struct snap *s, const char *path, int flags)
+{
+	struct snap_hdr hdr;
+	struct stat st;
+	uint64_t h;
+	void *p;
+	int fd, ret;
+
+	memset(s, '\0', sizeof(struct snap));
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return (SNAP_OPEN_FAILED);
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return (SNAP_READ_FAILED);
+	}
+	if ((size_t)st.st_size < sizeof(struct snap_hdr)) {
+		close(fd);
+		return (SNAP_BAD_FORMAT);
+	}
+
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return (SNAP_READ_FAILED);
+	s->base = p;
+	s->size = (size_t)st.st_size;
+	s->hdr = p;
+
+	if ((ret = snap_check_hdr(s->hdr, s->size)) != SNAP_ALL_OKAY)
+		goto fail;
+	if (!(flags & SNAP_NO_VERIFY)) {
+		/* Read once, sequentially. */
+		madvise(p, s->size, MADV_SEQUENTIAL);
+		h = snap_fnv(0xcbf29ce484222325ULL,
+			     s->base + sizeof(struct snap_hdr),
+			     s->size - sizeof(struct snap_hdr));
+		hdr = *s->hdr;
+		hdr.checksum = 0;
+		if (snap_fnv(h, &hdr, sizeof(hdr)) != s->hdr->checksum) {
+			ret = SNAP_BAD_CHECKSUM;
+			goto fail;
+		}
+	}
+	return (SNAP_ALL_OKAY);
+
+fail:
+	snap_do_close(s);
+	return (ret);
+}
+
+void snap_do_close(struct snap *s)
+{
+	if (s->base != NULL)
+		munmap((void *)s->base, s->size);
+	memset(s, '\0', sizeof(struct snap));
+}
+
+/* One block for count nodes of node_size bytes and a copy of the data.
+   data is stored at the start of each node. */
+static int snap_thaw(const struct snap *s, size_t node_size, void **block)
+{
+	const struct snap_rec *r;
+	char *p, *d, *end;
+	size_t i, len;
+
+	*block = NULL;
+	if (s->hdr->count == 0)
+		return (SNAP_ALL_OKAY);
+	if (s->hdr->count > (SIZE_MAX - s->hdr->data_size) / node_size)
+		return (SNAP_TOO_BIG);
+	/* node_size keeps the data aligned on 8. */
+	p = SNAP_MALLOC(s->hdr->count * node_size + s->hdr->data_size);
+	if (p == NULL)
+		return (SNAP_ALLOC_FAILED);
+
+	d = p + s->hdr->count * node_size;
+	end = d + s->hdr->data_size;
+	i = 0;
+	/* Only an unverified snapshot can be this bad: more or fewer
+	   records than counted (a misaligned or out of range next ends
+	   the walk early), or data past the end. */
+	SNAP_DO_FOREACH(s, r) {
+		if (i == s->hdr->count || r->next % 8 != 0 || r->prev % 8 != 0)
+			goto bad;
+		if (r->len == SNAP_NULL) {
+			*(void **)(p + i++ * node_size) = NULL;
+			continue;
+		}
+		len = (size_t)r->len;
+		if (SNAP_PAD(len) > (size_t)(end - d) ||
+		    len > (size_t)(s->base + s->size - (const char *)(r + 1)))
+			goto bad;
+		memcpy(d, r + 1, len);
+		*(void **)(p + i++ * node_size) = d;
+		d += SNAP_PAD(len);
+	}
+	if (i != s->hdr->count)
+		goto bad;
+
+	*block = p;
+	return (SNAP_ALL_OKAY);
+
+bad:
+	SNAP_FREE(p);
+	return (SNAP_BAD_FORMAT);
+}
+
+int snap_do_thaw_sll(const struct snap *s, struct sll_node **head,
+		     void **block)
+{
+	struct sll_node *n;
+	size_t i, count;
+	int ret;
+
+	*head = NULL;
+	if ((ret = snap_thaw(s, sizeof(struct sll_node), block)) !=
+	    SNAP_ALL_OKAY)
+		return (ret);
+
+	n = *block;
+	count = (size_t)s->hdr->count;
+	for (i = 0; i < count; i++)
+		n[i].next = i + 1 < count ? &n[i + 1] : NULL;
+	*head = count > 0 ? n : NULL;
+	return (SNAP_ALL_OKAY);
+}
+
+int snap_do_thaw_dlist(const struct snap *s, struct dlist **head,
+		       void **block)
+{
+	struct dlist *n;
+	size_t i, count;
+	int ret;
+
+	*head = NULL;
+	if ((ret = snap_thaw(s, sizeof(struct dlist), block)) !=
+	    SNAP_ALL_OKAY)
+		return (ret);
+
+	n = *block;
+	count = (size_t)s->hdr->count;
+	for (i = 0; i < count; i++) {
+		n[i].prev = i > 0 ? &n[i - 1] : NULL;
+		n[i].next = i + 1 < count ? &n[i + 1] : NULL;
+	}
+	*head = count > 0 ? n : NULL;
+	return (SNAP_ALL_OKAY);
+}
+
+int snap_do_thaw_ss(const struct snap *s, struct ss *ss, void **block)
+{
+	void **p;
+	size_t i, count;
+	int ret;
+
+	count = (size_t)s->hdr->count;
+	if (count > MAX_STACK_SIZE)
+		return (SNAP_TOO_BIG);
+	if ((ret = snap_thaw(s, sizeof(void *), block)) != SNAP_ALL_OKAY)
+		return (ret);
+
+	/* The pointers are the first part of the block. */
+	p = *block;
+	memset(ss->p, '\0', sizeof(ss->p));
+	for (i = 0; i < count; i++)
+		ss->p[i] = p[i];
+	ss->elem_idx = count;
+	return (SNAP_ALL_OKAY);
+}
+
+size_t snap_do_size_str(const void *data)
+{
+	return (strlen(data) + 1);
+}
+
+#endif /* SNAP_IMPL */
+
+#endif /* SNAP_H */
@@ -11,6 +11,14 @@
 # define SS_ELEM_TYPE     void
 #endif
 
+/* Trace the ss_do_* functions, see trace.h. */
+#ifdef SS_TRACE
+# include "trace.h"
+# define SS_TRACE_SCOPE()    TRACE_SCOPE(__func__)
+#else
+# define SS_TRACE_SCOPE()
+#endif
+
 /* When we've pushed or popped a value onto/from the program stack. */
 #define SS_ALL_OKAY        (0)
 
@@ -35,12 +43,16 @@ struct ss {
 
 void ss_do_init(struct ss *ss)
 {
+	SS_TRACE_SCOPE();
+
 	ss->elem_idx = 0;
 	memset(ss->p, '\0', MAX_STACK_SIZE);
 }
 
 int ss_do_push_back(struct ss *ss, const SS_ELEM_TYPE *elem)
 {
+	SS_TRACE_SCOPE();
+
 	if (ss->elem_idx == MAX_STACK_SIZE)
 		return (SS_STACK_FULL);
 
@@ -54,6 +66,7 @@ int ss_do_push_front(struct ss *ss, const SS_ELEM_TYPE *elem)
 	size_t j;
 	void *nelems[MAX_STACK_SIZE];
 	int is_first;
+	SS_TRACE_SCOPE();
 
 	if (ss->elem_idx == MAX_STACK_SIZE)
 		return (SS_STACK_FULL);
@@ -72,6 +85,8 @@ int ss_do_push_front(struct ss *ss, const SS_ELEM_TYPE *elem)
 /* TODO: Comment. */
 int ss_do_pop_back(struct ss *ss)
 {
+	SS_TRACE_SCOPE();
+
 	if (ss->elem_idx == 0)
 		return (SS_STACK_EMPTY);
 
@@ -82,6 +97,7 @@ int ss_do_pop_back(struct ss *ss)
 int ss_do_pop_front(struct ss *ss)
 {
 	size_t j;
+	SS_TRACE_SCOPE();
 
 	if (ss->elem_idx == 0)
 		return (SS_STACK_EMPTY);
@@ -99,6 +115,7 @@ int ss_do_stack_rev(struct ss *ss)
 {
 	size_t i, j, mid;
         SS_ELEM_TYPE *t;
+	SS_TRACE_SCOPE();
 
 	if (ss->elem_idx == 0)
 		return (SS_STACK_EMPTY);
@@ -117,6 +134,8 @@ int ss_do_stack_rev(struct ss *ss)
 /* TODO: clear to n-th position. */
 int ss_do_stack_clear(struct ss *ss)
 {
+	SS_TRACE_SCOPE();
+
 	if (ss->elem_idx == 0)
 		return (SS_STACK_EMPTY);
         while (ss->elem_idx > 0)
@@ -128,6 +147,7 @@ int ss_do_stack_clear(struct ss *ss)
 int ss_do_stack_clean_nth(struct ss *ss, size_t pos)
 {
         size_t i, j, k;
+	SS_TRACE_SCOPE();
 
 	if (ss->elem_idx == 0)
 		return (SS_STACK_EMPTY);
@@ -146,11 +166,15 @@ int ss_do_stack_clean_nth(struct ss *ss, size_t pos)
 
 SS_ELEM_TYPE *ss_do_get_elem(struct ss *ss, size_t idx)
 {
+	SS_TRACE_SCOPE();
+
 	return (ss->p[idx]);
 }
 
 SS_ELEM_TYPE *ss_do_get_elem_chkd(struct ss *ss, size_t idx)
 {
+	SS_TRACE_SCOPE();
+
 	if (idx >= ss->elem_idx)
 		return (NULL);
 	return (ss->p[idx]);
@@ -0,0 +1,162 @@
+/* Fixed size stack, C++ front-end of ss.h. Elements are stored in
+   place, every member function is constexpr when T is a literal
+   type. T must be default constructible, a free slot holds T{}.
+   Needs C++17. */
+
+#ifndef SS_HPP
+# define SS_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace ds {
+
+/* Same values as the SS_* constants of ss.h. */
+enum ss_status {
+	ss_all_okay = 0,
+	ss_stack_full = -1,
+	ss_stack_empty = -2,
+	ss_pos_too_high = -3
+};
+
+template <class T, std::size_t N>
+class ss {
+	static_assert(N > 0, "ss needs room for an element");
+
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = T &;
+	using const_reference = const T &;
+	using pointer = T *;
+	using const_pointer = const T *;
+	/* Contiguous, so plain pointers are random access iterators. */
+	using iterator = T *;
+	using const_iterator = const T *;
+
+	constexpr ss() = default;
+
+	constexpr iterator begin() noexcept { return (p_); }
+	constexpr iterator end() noexcept { return (p_ + n_); }
+	constexpr const_iterator begin() const noexcept { return (p_); }
+	constexpr const_iterator end() const noexcept { return (p_ + n_); }
+	constexpr const_iterator cbegin() const noexcept { return (p_); }
+	constexpr const_iterator cend() const noexcept { return (p_ + n_); }
+
+	constexpr bool empty() const noexcept { return (n_ == 0); }
+	constexpr bool full() const noexcept { return (n_ == N); }
+	constexpr size_type size() const noexcept { return (n_); }
+	static constexpr size_type capacity() noexcept { return (N); }
+
+	/* ss_do_get_elem(). */
+	constexpr reference operator[](size_type i) noexcept { return (p_[i]); }
+	constexpr const_reference operator[](size_type i) const noexcept
+	{
+		return (p_[i]);
+	}
+	/* ss_do_get_elem_chkd(), nullptr if out of range. */
+	constexpr pointer get(size_type i) noexcept
+	{
+		return (i < n_ ? &p_[i] : nullptr);
+	}
+	constexpr const_pointer get(size_type i) const noexcept
+	{
+		return (i < n_ ? &p_[i] : nullptr);
+	}
+
+	constexpr reference back() noexcept { return (p_[n_ - 1]); }
+	constexpr const_reference back() const noexcept { return (p_[n_ - 1]); }
+
+	/* ss_do_push_back(). */
+	constexpr ss_status push_back(const T &v)
+	{
+		if (n_ == N)
+			return (ss_stack_full);
+		p_[n_++] = v;
+		return (ss_all_okay);
+	}
+	constexpr ss_status push_back(T &&v)
+	{
+		if (n_ == N)
+			return (ss_stack_full);
+		p_[n_++] = std::move(v);
+		return (ss_all_okay);
+	}
+
+	/* ss_do_push_front(), shifts every element. */
+	constexpr ss_status push_front(T &&v)
+	{
+		if (n_ == N)
+			return (ss_stack_full);
+		for (size_type j = n_; j > 0; j--)
+			p_[j] = std::move(p_[j - 1]);
+		p_[0] = std::move(v);
+		n_++;
+		return (ss_all_okay);
+	}
+	constexpr ss_status push_front(const T &v)
+	{
+		return (push_front(T(v)));
+	}
+
+	/* ss_do_pop_back(). */
+	constexpr ss_status pop_back()
+	{
+		if (n_ == 0)
+			return (ss_stack_empty);
+		p_[--n_] = T{};
+		return (ss_all_okay);
+	}
+
+	/* ss_do_pop_front(). */
+	constexpr ss_status pop_front()
+	{
+		return (erase_at(0));
+	}
+
+	/* ss_do_stack_clean_nth(). */
+	constexpr ss_status erase_at(size_type pos)
+	{
+		if (n_ == 0)
+			return (ss_stack_empty);
+		if (pos >= n_)
+			return (ss_pos_too_high);
+		for (size_type j = pos; j + 1 < n_; j++)
+			p_[j] = std::move(p_[j + 1]);
+		p_[--n_] = T{};
+		return (ss_all_okay);
+	}
+
+	/* ss_do_stack_rev(). */
+	constexpr ss_status reverse()
+	{
+		if (n_ == 0)
+			return (ss_stack_empty);
+		for (size_type i = 0, j = n_ - 1; i < j; i++, j--) {
+			T t = std::move(p_[i]);
+
+			p_[i] = std::move(p_[j]);
+			p_[j] = std::move(t);
+		}
+		return (ss_all_okay);
+	}
+
+	/* ss_do_stack_clear(). */
+	constexpr ss_status clear()
+	{
+		if (n_ == 0)
+			return (ss_stack_empty);
+		while (n_ > 0)
+			p_[--n_] = T{};
+		return (ss_all_okay);
+	}
+
+private:
+	T p_[N]{};
+	size_type n_ = 0;
+};
+
+} /* namespace ds */
+
+#endif /* SS_HPP */
@@ -0,0 +1,75 @@
+/* Fixture tests of the cgroup v2 reader, on a fake sysfs tree.
+   From the top directory:
+     cc -O2 -o test_cgroup tests/test_cgroup.c && ./test_cgroup */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+#define CGROUP2_ROOT_PATH        FIXTURES "/cgroup"
+#define PROC_SELF_CGROUP_PATH    FIXTURES "/cgroup/self_cgroup"
+
+#define CGROUP_IMPL
+#define PROCFS_IMPL
+#define YTEST_IMPL
+#include "../linux/cgroup.h"
+#include "../ytest.h"
+
+YTEST(discover)
+{
+	struct proc_buf pb = { 0 };
+	char dir[CGROUP_PATH_MAX];
+
+	yassert_i32_eq(cgroup_do_discover(&pb, NULL, dir, sizeof(dir)),
+		       CGROUP_ALL_OKAY);
+	yassert_cp_case_eq(dir, FIXTURES "/cgroup/app.slice");
+	yassert_i32_eq(cgroup_do_discover(&pb, NULL, dir, 8),
+		       CGROUP_PATH_TOO_LONG);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(read_child)
+{
+	struct proc_buf pb = { 0 };
+	struct cgroup_memory cm;
+
+	yassert_i32_eq(cgroup_do_read_memory(&pb, FIXTURES "/cgroup/app.slice",
+					     &cm), CGROUP_ALL_OKAY);
+	yassert_u64_eq(cm.current, 536870912);
+	yassert_u64_eq(cm.max, 1073741824);
+	yassert_u64_eq(cm.high, CGROUP_MEM_UNLIMITED);
+	yassert_u64_eq(cm.stat.anon, 402653184);
+	yassert_u64_eq(cm.events.max, 3);
+	yassert_u64_eq(cm.events.oom_kill, 1);
+	/* 512 MB left, plus 96 MB of inactive page cache. */
+	yassert_u64_eq(cgroup_do_mem_avail(&cm), 536870912 + 100663296);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(read_root)
+{
+	struct proc_buf pb = { 0 };
+	struct cgroup_memory cm;
+
+	/* Only memory.stat is there. */
+	yassert_i32_eq(cgroup_do_read_memory(&pb, FIXTURES "/cgroup", &cm),
+		       CGROUP_ALL_OKAY);
+	yassert_u64_eq(cm.current,
+		       1048576000ULL + 2097152000ULL + 104857600ULL + 4096);
+	yassert_u64_eq(cm.max, CGROUP_MEM_UNLIMITED);
+	yassert_u64_eq(cm.high, CGROUP_MEM_UNLIMITED);
+	yassert_u64_eq(cgroup_do_mem_avail(&cm), CGROUP_MEM_UNLIMITED);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(read_missing)
+{
+	struct proc_buf pb = { 0 };
+	struct cgroup_memory cm;
+
+	yassert_i32_eq(cgroup_do_read_memory(&pb, FIXTURES "/cgroup/none",
+					     &cm), CGROUP_OPEN_FAILED);
+	proc_do_buf_free(&pb);
+}
+
+YTEST_MAIN()
@@ -0,0 +1,90 @@
+/* Trimming of the huge page pool, on normal pages.
+   From the top directory:
+     cc -O2 -o test_hpool tests/test_hpool.c && ./test_hpool */
+
+#include <stddef.h>
+#include <string.h>
+
+#define PROCFS_IMPL
+#define HPOOL_IMPL
+#define YTEST_IMPL
+#include "../linux/procfs.h"
+#include "../linux/hpool.h"
+#include "../ytest.h"
+
+/* 32 objects per slab. */
+#define TEST_OBJ_SIZE     (HPOOL_SLAB_SIZE / 32)
+#define TEST_NOBJS        (4 * 32)
+
+static void *test_objs[TEST_NOBJS];
+
+static void test_pool(struct hpool *hp)
+{
+	struct proc_meminfo mi;
+	size_t i;
+
+	/* No huge page size known: HPOOL_SLAB_SIZE slabs. */
+	memset(&mi, '\0', sizeof(mi));
+	yassert_i64_eq(hpool_do_init(hp, TEST_OBJ_SIZE,
+				     HPOOL_NO_HUGETLB | HPOOL_NO_THP, &mi),
+		       HPOOL_ALL_OKAY);
+	for (i = 0; i < TEST_NOBJS; i++) {
+		test_objs[i] = hpool_do_alloc(hp);
+		yassert(test_objs[i] != NULL);
+		memset(test_objs[i], (int)i, TEST_OBJ_SIZE);
+	}
+	yassert_i64_eq(hp->nslabs[HPOOL_NORMAL], 4);
+}
+
+YTEST(trim_follows_fraction)
+{
+	struct hpool hp;
+	size_t i;
+
+	test_pool(&hp);
+	yassert_i64_eq(hpool_do_trim(&hp, 1), 0);
+	for (i = 0; i < TEST_NOBJS; i++)
+		hpool_do_free(&hp, test_objs[i]);
+
+	yassert_i64_eq(hpool_do_trim(&hp, 0), 0);
+	yassert_i64_eq(hpool_do_trim(&hp, 0.5), 2 * HPOOL_SLAB_SIZE);
+	/* Rounded up: one of the two idle slabs left. */
+	yassert_i64_eq(hpool_do_trim(&hp, 0.1), HPOOL_SLAB_SIZE);
+	yassert_i64_eq(hpool_do_trim(&hp, 1), HPOOL_SLAB_SIZE);
+	yassert_i64_eq(hpool_do_trim(&hp, 1), 0);
+	hpool_do_destroy(&hp);
+}
+
+YTEST(live_objects_are_kept)
+{
+	struct hpool hp;
+	unsigned char *keep;
+	size_t i;
+
+	test_pool(&hp);
+	/* One live object in the second slab. */
+	keep = test_objs[40];
+	for (i = 0; i < TEST_NOBJS; i++) {
+		if (test_objs[i] != keep)
+			hpool_do_free(&hp, test_objs[i]);
+	}
+
+	yassert_i64_eq(hpool_do_trim(&hp, 1), 3 * HPOOL_SLAB_SIZE);
+	yassert_i64_eq(keep[0], 40);
+	yassert_i64_eq(keep[TEST_OBJ_SIZE - 1], 40);
+
+	/* The free list only holds objects of the slab left, and the
+	   trimmed ones are carved again without mapping new ones. */
+	for (i = 0; i < TEST_NOBJS - 1; i++) {
+		test_objs[i] = hpool_do_alloc(&hp);
+		yassert(test_objs[i] != NULL);
+		yassert(test_objs[i] != keep);
+		memset(test_objs[i], 0xff, TEST_OBJ_SIZE);
+	}
+	yassert_i64_eq(hp.nslabs[HPOOL_NORMAL], 4);
+	yassert_i64_eq(hp.live, TEST_NOBJS);
+	yassert_i64_eq(keep[0], 40);
+	hpool_do_destroy(&hp);
+}
+
+YTEST_MAIN()
@@ -0,0 +1,135 @@
+/* Leak checks of sll and dlist with the allocation accounting.
+   From the top directory:
+     cc -O2 -pthread -o test_memacct tests/test_memacct.c && ./test_memacct */
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define SLL_ACCT
+#define DLIST_ACCT
+#define SLL_IMPL
+#define DLIST_IMPL
+#define MEMACCT_IMPL
+#define YTEST_IMPL
+#include "../sll.h"
+#include "../dlist.h"
+#include "../ytest.h"
+
+static int test_data[8];
+
+YTEST(sll_no_leak)
+{
+	struct memacct_stats before;
+	struct sll_node *head;
+	size_t i;
+
+	memacct_do_read(&before);
+	SLL_DO_INIT(head);
+	for (i = 0; i < 8; i++)
+		SLL_DO_PUSH_BACK(head, &test_data[i]);
+	yassert_i64_eq(memacct_do_leaked(&before, MEMACCT_SLL), 8);
+	SLL_DO_REMOVE_FIRST(head);
+	SLL_DO_FREE(head);
+	yassert(memacct_do_report(stderr, &before) == 0);
+}
+
+YTEST(sll_leak_is_reported)
+{
+	struct memacct_stats before;
+	struct sll_node *head;
+
+	memacct_do_read(&before);
+	SLL_DO_INIT(head);
+	SLL_DO_PUSH_FRONT(head, &test_data[0]);
+	SLL_DO_PUSH_FRONT(head, &test_data[1]);
+	/* Lose the first node. */
+	head = head->next;
+	yassert_i64_eq(memacct_do_leaked(&before, MEMACCT_SLL), 2);
+	SLL_DO_FREE(head);
+	yassert_i64_eq(memacct_do_leaked(&before, MEMACCT_SLL), 1);
+	yassert_i64_eq(memacct_do_leaked(&before, MEMACCT_TOTAL), 1);
+	yassert(memacct_do_report(stdout, &before) == 1);
+}
+
+YTEST(dlist_no_leak)
+{
+	struct memacct_stats before, after;
+	struct dlist *head;
+	size_t i;
+
+	memacct_do_read(&before);
+	DLIST_DO_INIT(head);
+	for (i = 0; i < 8; i++)
+		DLIST_DO_PUSH_FRONT(head, &test_data[i]);
+	DLIST_DO_DELETE_LAST(head);
+	DLIST_DO_FREE(head);
+	yassert(memacct_do_report(stderr, &before) == 0);
+
+	memacct_do_read(&after);
+	yassert_u64_eq(after.kinds[MEMACCT_DLIST].nallocs -
+		       before.kinds[MEMACCT_DLIST].nallocs, 8);
+	yassert_u64_eq(after.kinds[MEMACCT_DLIST].nfrees -
+		       before.kinds[MEMACCT_DLIST].nfrees, 8);
+}
+
+static void *test_free_list(void *arg)
+{
+	SLL_DO_FREE(arg);
+	return (NULL);
+}
+
+/* Counters are summed over threads, so nodes may be freed by another
+   thread than the one that allocated them. */
+YTEST(freed_by_another_thread)
+{
+	struct memacct_stats before;
+	struct sll_node *head;
+	pthread_t tid;
+	size_t i;
+
+	memacct_do_read(&before);
+	SLL_DO_INIT(head);
+	for (i = 0; i < 8; i++)
+		SLL_DO_PUSH_FRONT(head, &test_data[i]);
+	yassert(pthread_create(&tid, NULL, test_free_list, head) == 0);
+	pthread_join(tid, NULL);
+	yassert(memacct_do_report(stderr, &before) == 0);
+}
+
+static void *test_register(void *arg)
+{
+	*(int *)arg = memacct_do_register_kind("pool");
+	return (NULL);
+}
+
+YTEST(register_kind)
+{
+	struct memacct_stats st;
+	pthread_t tids[MEMACCT_MAX_KINDS];
+	int kinds[MEMACCT_MAX_KINDS];
+	size_t i, n;
+
+	/* Concurrent registrations get distinct kinds, all named. */
+	for (i = 0; i < MEMACCT_MAX_KINDS; i++)
+		yassert(pthread_create(&tids[i], NULL, test_register,
+				       &kinds[i]) == 0);
+	n = 0;
+	for (i = 0; i < MEMACCT_MAX_KINDS; i++) {
+		pthread_join(tids[i], NULL);
+		n += kinds[i] != -1;
+	}
+	yassert_u64_eq(n, MEMACCT_MAX_KINDS - MEMACCT_NBUILTIN);
+
+	memacct_do_read(&st);
+	yassert_u64_eq(st.nkinds, MEMACCT_MAX_KINDS);
+	for (i = 0; i < st.nkinds; i++)
+		yassert(st.kinds[i].name != NULL);
+	yassert_cp_case_eq(st.kinds[MEMACCT_NBUILTIN].name, "pool");
+
+	memacct_do_alloc(MEMACCT_NBUILTIN, 100);
+	yassert_i64_eq(memacct_do_leaked(NULL, MEMACCT_NBUILTIN), 1);
+	memacct_do_free(MEMACCT_NBUILTIN, 100);
+	yassert(memacct_do_report(stderr, NULL) == 0);
+}
+
+YTEST_MAIN()
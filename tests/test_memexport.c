@@ -0,0 +1,69 @@
+/* Tests of the meminfo exporters, on the meminfo fixture.
+   From the top directory:
+     cc -O2 -o test_memexport tests/test_memexport.c && ./test_memexport */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+#define PROC_MEMINFO_PATH    FIXTURES "/proc/meminfo"
+
+#define MEMEXPORT_IMPL
+#define PROCFS_IMPL
+#define YTEST_IMPL
+#include "../linux/memexport.h"
+#include "../ytest.h"
+
+YTEST(every_field_is_named)
+{
+	size_t i;
+
+	/* A hole in the designated initializers is NULL. */
+	for (i = 0; i < PROC_MEMINFO_NFIELDS; i++)
+		yassert(memexport_metrics[i].name != NULL);
+}
+
+YTEST(text)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_meminfo mi;
+	char buf[8192];
+	ssize_t n;
+
+	yassert_i32_eq(proc_do_read_meminfo(&pb, &mi), PROC_KV_ALL_OKAY);
+	n = memexport_do_text(&mi, buf, sizeof(buf) - 1);
+	yassert(n > 0);
+	buf[n] = '\0';
+	yassert(strstr(buf, "node_memory_MemTotal_bytes 6305947648\n") != NULL);
+	yassert(strstr(buf, "node_memory_HugePages_Total ") != NULL);
+	yassert_i32_eq(memexport_do_text(&mi, buf, 64), MEMEXPORT_NO_SPACE);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(binary_round_trip)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_meminfo mi, next, out;
+	uint8_t buf[MEMEXPORT_BINARY_MAX];
+	ssize_t n;
+
+	yassert_i32_eq(proc_do_read_meminfo(&pb, &mi), PROC_KV_ALL_OKAY);
+	n = memexport_do_binary(&mi, NULL, buf, sizeof(buf));
+	yassert(n > 0);
+	yassert(memexport_do_decode_binary(buf, (size_t)n, NULL, &out) == n);
+	yassert(memcmp(&mi, &out, sizeof(mi)) == 0);
+
+	/* Deltas, negative ones included. */
+	next = mi;
+	next.mem_free -= 1000;
+	next.cached += 12;
+	n = memexport_do_binary(&next, &mi, buf, sizeof(buf));
+	yassert(n > 0);
+	yassert(memexport_do_decode_binary(buf, (size_t)n, NULL, &out) ==
+		MEMEXPORT_BAD_FORMAT);
+	yassert(memexport_do_decode_binary(buf, (size_t)n, &mi, &out) == n);
+	yassert(memcmp(&next, &out, sizeof(next)) == 0);
+	proc_do_buf_free(&pb);
+}
+
+YTEST_MAIN()
@@ -0,0 +1,117 @@
+/* Fixture tests of the pressure thresholds and of the trim
+   callbacks.
+   From the top directory:
+     cc -O2 -pthread -o test_memtrim tests/test_memtrim.c && ./test_memtrim */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+/* Each test picks its own meminfo. */
+static const char *test_meminfo_path;
+
+#define PROC_MEMINFO_PATH    test_meminfo_path
+
+#define PROCFS_IMPL
+#define MEMTRIM_IMPL
+#define YTEST_IMPL
+#include "../linux/procfs.h"
+#include "../linux/memtrim.h"
+#include "../ytest.h"
+
+/* MemAvailable / MemTotal and Committed_AS / CommitLimit of each:
+     calm: 0.5 and 0.5, below both ramps;
+     mid: 0.125, half way down the default avail ramp, and 0.5;
+     full: 0.5 and 1.05, past the end of the commit ramp. */
+#define TEST_CALM    FIXTURES "/memtrim/meminfo_calm"
+#define TEST_MID     FIXTURES "/memtrim/meminfo_mid"
+#define TEST_FULL    FIXTURES "/memtrim/meminfo_full"
+
+static double test_fraction;
+static int test_calls;
+
+static size_t test_trim(void *arg, double fraction)
+{
+	test_fraction = fraction;
+	test_calls++;
+	return (*(size_t *)arg);
+}
+
+/* Fraction memtrim_do_tick() computes from path. */
+static double test_tick(const struct memtrim_policy *pol, const char *path,
+			size_t *released)
+{
+	struct proc_buf pb = { 0 };
+	double f;
+
+	test_meminfo_path = path;
+	yassert_i32_eq(memtrim_do_tick(pol, &pb, &f, released),
+		       PROC_KV_ALL_OKAY);
+	proc_do_buf_free(&pb);
+	return (f);
+}
+
+YTEST(default_policy)
+{
+	struct memtrim_policy pol = MEMTRIM_POLICY_DEFAULT;
+	double f;
+
+	yassert_f64_eq(test_tick(&pol, TEST_CALM, NULL), 0.0);
+	f = test_tick(&pol, TEST_MID, NULL);
+	yassert(f > 0.4999 && f < 0.5001);
+	yassert_f64_eq(test_tick(&pol, TEST_FULL, NULL), 1.0);
+}
+
+YTEST(step_policy)
+{
+	/* start == full: a step, the commit ratio still has to go up
+	   to cross it. */
+	struct memtrim_policy pol = { 0.20, 0.20, 0.95, 0.95 };
+
+	yassert_f64_eq(test_tick(&pol, TEST_CALM, NULL), 0.0);
+	yassert_f64_eq(test_tick(&pol, TEST_MID, NULL), 1.0);
+	yassert_f64_eq(test_tick(&pol, TEST_FULL, NULL), 1.0);
+}
+
+YTEST(callback_gets_the_fraction)
+{
+	struct memtrim_policy pol = MEMTRIM_POLICY_DEFAULT;
+	size_t bytes, released;
+	double f;
+	int id;
+
+	bytes = 4096;
+	yassert((id = memtrim_do_register("test", test_trim, &bytes)) >= 0);
+
+	/* No pressure, no call. */
+	test_tick(&pol, TEST_CALM, &released);
+	yassert_i32_eq(test_calls, 0);
+	yassert_u64_eq(released, 0);
+
+	f = test_tick(&pol, TEST_MID, &released);
+	yassert_i32_eq(test_calls, 1);
+	yassert_f64_eq(test_fraction, f);
+	yassert_u64_eq(released, 4096);
+
+	test_tick(&pol, TEST_FULL, &released);
+	yassert_i32_eq(test_calls, 2);
+	yassert_f64_eq(test_fraction, 1.0);
+
+	memtrim_do_unregister(id);
+	test_tick(&pol, TEST_FULL, &released);
+	yassert_i32_eq(test_calls, 2);
+	yassert_u64_eq(released, 0);
+}
+
+YTEST(missing_file)
+{
+	struct memtrim_policy pol = MEMTRIM_POLICY_DEFAULT;
+	struct proc_buf pb = { 0 };
+
+	test_meminfo_path = FIXTURES "/memtrim/no_such_file";
+	yassert_i32_eq(memtrim_do_tick(&pol, &pb, NULL, NULL),
+		       PROC_KV_OPEN_FAILED);
+	proc_do_buf_free(&pb);
+}
+
+YTEST_MAIN()
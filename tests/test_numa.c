@@ -0,0 +1,99 @@
+/* Fixture tests of the per-node meminfo sampler, on a fake sysfs
+   tree.
+   From the top directory:
+     cc -O2 -o test_numa tests/test_numa.c && ./test_numa */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+#define SYS_NODE_PATH    FIXTURES "/node"
+
+#define PROCFS_IMPL
+#define NUMA_IMPL
+#define YTEST_IMPL
+#include "../linux/procfs.h"
+#include "../linux/numa.h"
+#include "../ytest.h"
+
+YTEST(nodes_are_sorted)
+{
+	struct numa_meminfo nm;
+
+	/* nodeX and online aren't nodes, node10 sorts after node1. */
+	yassert_i32_eq(numa_do_init(&nm, NULL), NUMA_ALL_OKAY);
+	yassert_u64_eq(nm.nnodes, 3);
+	yassert_i32_eq(nm.ids[0], 0);
+	yassert_i32_eq(nm.ids[1], 1);
+	yassert_i32_eq(nm.ids[2], 10);
+	numa_do_close(&nm);
+}
+
+YTEST(sample)
+{
+	struct numa_meminfo nm;
+
+	yassert_i32_eq(numa_do_init(&nm, SYS_NODE_PATH), NUMA_ALL_OKAY);
+	yassert_i32_eq(numa_do_sample(&nm), NUMA_ALL_OKAY);
+
+	yassert_u64_eq(nm.nodes[0].mem_total, 5209848);
+	yassert_u64_eq(nm.nodes[0].mem_free, 4111540);
+	/* Not mistaken for Active(file). */
+	yassert_u64_eq(nm.nodes[0].inactive_file, 472160);
+	yassert_u64_eq(nm.nodes[0].k_reclaimable, 17872);
+
+	yassert_u64_eq(nm.nodes[1].mem_total, 8000000);
+	yassert_u64_eq(nm.nodes[1].active_file, 300);
+	yassert_u64_eq(nm.nodes[1].huge_pages_total, 4);
+
+	/* Two digit node number in the prefix, missing keys are 0. */
+	yassert_u64_eq(nm.nodes[2].mem_total, 2097152);
+	yassert_u64_eq(nm.nodes[2].mem_free, 1048576);
+	yassert_u64_eq(nm.nodes[2].huge_pages_free, 2);
+	yassert_u64_eq(nm.nodes[2].active_file, 0);
+	numa_do_close(&nm);
+}
+
+YTEST(node_avail)
+{
+	struct numa_meminfo nm;
+
+	yassert_i32_eq(numa_do_init(&nm, NULL), NUMA_ALL_OKAY);
+	yassert_i32_eq(numa_do_sample(&nm), NUMA_ALL_OKAY);
+	/* 4111540 + (367624 + 472160) / 2 + 17872 / 2 */
+	yassert_u64_eq(numa_do_node_avail(&nm.nodes[0]), 4540368);
+	/* 1000 + (300 + 101) / 2 + 51 / 2, rounded down. */
+	yassert_u64_eq(numa_do_node_avail(&nm.nodes[1]), 1225);
+	yassert_u64_eq(numa_do_node_avail(&nm.nodes[2]), 1048576);
+	numa_do_close(&nm);
+}
+
+YTEST(samples_reuse_the_buffer)
+{
+	struct numa_meminfo nm;
+	const char *data;
+	size_t cap;
+	int i;
+
+	yassert_i32_eq(numa_do_init(&nm, NULL), NUMA_ALL_OKAY);
+	data = nm.pb.data;
+	cap = nm.pb.cap;
+	for (i = 0; i < 16; i++) {
+		yassert_i32_eq(numa_do_sample(&nm), NUMA_ALL_OKAY);
+		yassert(nm.pb.data == data);
+		yassert_u64_eq(nm.pb.cap, cap);
+		yassert_u64_eq(nm.nodes[1].mem_total, 8000000);
+	}
+	numa_do_close(&nm);
+}
+
+YTEST(no_nodes)
+{
+	struct numa_meminfo nm;
+
+	yassert_i32_eq(numa_do_init(&nm, FIXTURES "/proc"), NUMA_NO_NODES);
+	yassert_i32_eq(numa_do_init(&nm, FIXTURES "/no_such_dir"),
+		       NUMA_OPEN_FAILED);
+}
+
+YTEST_MAIN()
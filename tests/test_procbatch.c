@@ -0,0 +1,76 @@
+/* Tests of the batched reads, with both backends, on fixtures.
+   From the top directory:
+     cc -O2 -o test_procbatch tests/test_procbatch.c && ./test_procbatch */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+#define PROCBATCH_IMPL
+#define PROCFS_IMPL
+#define YTEST_IMPL
+#include "../linux/procbatch.h"
+#include "../ytest.h"
+
+static void test_batch(int flags)
+{
+	struct proc_batch b;
+	struct proc_buf pb = { 0 };
+	static const char *paths[] = {
+		FIXTURES "/proc/meminfo",
+		FIXTURES "/proc/vmstat",
+		FIXTURES "/cgroup/app.slice/memory.current",
+	};
+	size_t i;
+	int tick;
+
+	yassert_i32_eq(proc_batch_do_init(&b, flags), PROC_BATCH_ALL_OKAY);
+	for (i = 0; i < PROC_KV_NFIELDS(paths); i++)
+		yassert_i32_eq(proc_batch_do_add(&b, paths[i]), (int32_t)i);
+
+	/* The second tick reuses the registered files. */
+	for (tick = 0; tick < 2; tick++) {
+		yassert_i32_eq(proc_batch_do_read(&b), PROC_BATCH_ALL_OKAY);
+		for (i = 0; i < PROC_KV_NFIELDS(paths); i++) {
+			yassert_i32_eq(proc_do_buf_read(&pb, paths[i]),
+				       PROC_KV_ALL_OKAY);
+			yassert_u64_eq(b.bufs[i].len, pb.len);
+			yassert(memcmp(b.bufs[i].data, pb.data, pb.len) == 0);
+		}
+	}
+
+	proc_batch_do_close(&b);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(pread_is_the_default)
+{
+	struct proc_batch b;
+
+	proc_batch_do_init(&b, 0);
+	yassert_i32_eq(b.use_uring, 0);
+	proc_batch_do_close(&b);
+}
+
+YTEST(read_pread)
+{
+	test_batch(0);
+}
+
+/* Falls back to pread(2) where io_uring is refused. */
+YTEST(read_io_uring)
+{
+	test_batch(PROC_BATCH_IO_URING);
+}
+
+YTEST(add_missing)
+{
+	struct proc_batch b;
+
+	proc_batch_do_init(&b, 0);
+	yassert_i32_eq(proc_batch_do_add(&b, FIXTURES "/nonexistent"),
+		       PROC_BATCH_OPEN_FAILED);
+	proc_batch_do_close(&b);
+}
+
+YTEST_MAIN()
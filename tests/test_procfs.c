@@ -0,0 +1,139 @@
+/* Fixture tests of the /proc key-value engine and its typed readers.
+   From the top directory:
+     cc -O2 -o test_procfs tests/test_procfs.c && ./test_procfs */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+#define PROC_MEMINFO_PATH         FIXTURES "/proc/meminfo"
+#define PROC_VMSTAT_PATH          FIXTURES "/proc/vmstat"
+#define PROC_SELF_STATUS_PATH     FIXTURES "/proc/self_status"
+#define PROC_SMAPS_ROLLUP_PATH    FIXTURES "/proc/smaps_rollup"
+#define PROC_STAT_PATH            FIXTURES "/proc/stat"
+
+#define PROCFS_IMPL
+#define YTEST_IMPL
+#include "../linux/procfs.h"
+#include "../ytest.h"
+
+YTEST(read_meminfo)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_meminfo mi;
+
+	yassert_i32_eq(proc_do_read_meminfo(&pb, &mi), PROC_KV_ALL_OKAY);
+	yassert_u64_eq(mi.mem_total, 6158152);
+	yassert_u64_eq(mi.mem_avail, 5682588);
+	/* Not mistaken for Active(anon). */
+	yassert_u64_eq(mi.active, 353044);
+	yassert_u64_eq(mi.active_anon, 20);
+	yassert_u64_eq(mi.committed_as, 343140);
+	yassert_u64_eq(mi.huge_page_size, 2048);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(meminfo_legacy_api)
+{
+	struct proc_meminfo mi;
+	uint64_t v;
+	char *p;
+
+	yassert_i32_eq(proc_do_init_meminfo(&mi, &p), PROC_MEMINFO_ALL_OKAY);
+	proc_do_collect_all(&mi, p);
+	yassert_u64_eq(mi.mem_total, 6158152);
+	yassert_u64_eq(mi.active, 353044);
+
+	/* Overwritten, not accumulated into. */
+	v = 12345;
+	yassert_i32_eq(proc_do_get_kv(p, "MemAvailable:", &v),
+		       PROC_MEMINFO_ALL_OKAY);
+	yassert_u64_eq(v, 5682588);
+	yassert_i32_eq(proc_do_get_kv(p, "Active", &v), PROC_MEMINFO_ALL_OKAY);
+	yassert_u64_eq(v, 353044);
+	yassert_i32_eq(proc_do_get_kv(p, "NoSuchKey:", &v), PROC_MEMINFO_NO_KEY);
+	free(p);
+}
+
+YTEST(read_vmstat)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_vmstat vs;
+
+	yassert_i32_eq(proc_do_read_vmstat(&pb, &vs), PROC_KV_ALL_OKAY);
+	yassert_u64_eq(vs.nr_free_pages, 1028886);
+	yassert_u64_eq(vs.pgfault, 13074715);
+	yassert_u64_eq(vs.oom_kill, 0);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(read_self_status)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_self_status ss;
+
+	yassert_i32_eq(proc_do_read_self_status(&pb, &ss), PROC_KV_ALL_OKAY);
+	yassert_u64_eq(ss.pid, 20349);
+	yassert_u64_eq(ss.vm_rss, 1884);
+	yassert_u64_eq(ss.threads, 1);
+	yassert_u64_eq(ss.nonvoluntary_ctxt_switches, 2);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(read_smaps_rollup)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_smaps_rollup sr;
+
+	yassert_i32_eq(proc_do_read_smaps_rollup(&pb, &sr), PROC_KV_ALL_OKAY);
+	yassert_u64_eq(sr.rss, 2072);
+	yassert_u64_eq(sr.pss, 966);
+	yassert_u64_eq(sr.pss_anon, 148);
+	yassert_u64_eq(sr.swap_pss, 0);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(read_stat)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_stat st;
+
+	yassert_i32_eq(proc_do_read_stat(&pb, &st), PROC_KV_ALL_OKAY);
+	/* The "cpu" total, not "cpu0". */
+	yassert_u64_eq(st.cpu.user, 40041);
+	yassert_u64_eq(st.cpu.system, 6093);
+	yassert_u64_eq(st.cpu.idle, 185636);
+	yassert_u64_eq(st.cpu.steal, 722);
+	yassert_u64_eq(st.intr, 219343);
+	yassert_u64_eq(st.ctxt, 648635);
+	yassert_u64_eq(st.processes, 52821);
+	yassert_u64_eq(st.softirq, 134963);
+	proc_do_buf_free(&pb);
+}
+
+YTEST(buffer_is_reused)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_meminfo mi;
+	char *data;
+
+	yassert_i32_eq(proc_do_read_meminfo(&pb, &mi), PROC_KV_ALL_OKAY);
+	data = pb.data;
+	yassert_i32_eq(proc_do_read_meminfo(&pb, &mi), PROC_KV_ALL_OKAY);
+	yassert(pb.data == data);
+	yassert(pb.data[pb.len] == '\0');
+	proc_do_buf_free(&pb);
+}
+
+YTEST(missing_file)
+{
+	struct proc_buf pb = { 0 };
+	struct proc_vmstat vs;
+
+	yassert_i32_eq(proc_do_read_kv(&pb, FIXTURES "/proc/nonexistent",
+				       NULL, 0, &vs, sizeof(vs)),
+		       PROC_KV_OPEN_FAILED);
+	proc_do_buf_free(&pb);
+}
+
+YTEST_MAIN()
@@ -0,0 +1,62 @@
+/* Tests of the /proc/[pid] scanner, on a fixture tree.
+   From the top directory:
+     cc -O2 -pthread -o test_procscan tests/test_procscan.c && ./test_procscan */
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+#define PROCSCAN_IMPL
+#define PROCFS_IMPL
+#define YTEST_IMPL
+#include "../linux/procscan.h"
+#include "../ytest.h"
+
+YTEST(top)
+{
+	struct procscan_entry out[4];
+	uint64_t page_kb;
+
+	page_kb = (uint64_t)sysconf(_SC_PAGESIZE) / 1024;
+	/* "self" isn't a pid, and 2 has an empty statm. */
+	yassert_i32_eq(procscan_do_top(FIXTURES "/procscan", 2, out, 4), 3);
+
+	yassert_i32_eq(out[0].pid, 100);
+	yassert_u64_eq(out[0].rss, 65536 * page_kb);
+	yassert_u64_eq(out[0].vm_size, 262144 * page_kb);
+	yassert_u64_eq(out[0].vm_hwm, 300000);
+	yassert_u64_eq(out[0].rss_anon, 253952);
+	yassert_u64_eq(out[0].rss_shmem, 4096);
+	yassert_u64_eq(out[0].vm_swap, 65536);
+	/* Truncated, as the kernel does. */
+	yassert_cp_case_eq(out[0].comm, "a-very-long-pro");
+
+	yassert_i32_eq(out[1].pid, 1);
+	yassert_u64_eq(out[1].shared, 1792 * page_kb);
+	yassert_u64_eq(out[1].rss_file, 7168);
+	yassert_cp_case_eq(out[1].comm, "systemd");
+
+	/* Kernel threads have no memory lines. */
+	yassert_i32_eq(out[2].pid, 2);
+	yassert_u64_eq(out[2].rss, 0);
+	yassert_u64_eq(out[2].vm_hwm, 0);
+	yassert_cp_case_eq(out[2].comm, "kthreadd");
+}
+
+YTEST(top_one)
+{
+	struct procscan_entry out[1];
+
+	yassert_i32_eq(procscan_do_top(FIXTURES "/procscan", 1, out, 1), 1);
+	yassert_i32_eq(out[0].pid, 100);
+}
+
+YTEST(missing_root)
+{
+	struct procscan_entry out[1];
+
+	yassert_i32_eq(procscan_do_top(FIXTURES "/nonexistent", 1, out, 1),
+		       PROCSCAN_OPEN_FAILED);
+}
+
+YTEST_MAIN()
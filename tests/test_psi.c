@@ -0,0 +1,94 @@
+/* Fixture tests of the PSI reader, and of the triggers emulated on a
+   file that isn't in procfs.
+   From the top directory:
+     cc -O2 -o test_psi tests/test_psi.c && ./test_psi */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#ifndef FIXTURES
+# define FIXTURES    "tests/fixtures"
+#endif
+
+/* Switched to a scratch copy by the trigger tests. */
+static const char *test_psi_path = FIXTURES "/proc/pressure_memory";
+
+#define PROC_PSI_MEMORY_PATH    test_psi_path
+
+#define MEMINFO_IMPL
+#define PSI_IMPL
+#define YTEST_IMPL
+#include "../linux/psi.h"
+#include "../ytest.h"
+
+/* Scratch pressure file with the given totals. Tests may run in
+   parallel, each gets its own file. */
+static void test_write_totals(char *path, size_t len, uint64_t some,
+			      uint64_t full)
+{
+	FILE *fp;
+
+	snprintf(path, len, "/tmp/test_psi.%ld", (long)getpid());
+	yassert((fp = fopen(path, "w")) != NULL);
+	fprintf(fp, "some avg10=0.00 avg60=0.00 avg300=0.00 total=%llu\n"
+		"full avg10=0.00 avg60=0.00 avg300=0.00 total=%llu\n",
+		(unsigned long long)some, (unsigned long long)full);
+	fclose(fp);
+	test_psi_path = path;
+}
+
+YTEST(read_pressure)
+{
+	struct psi_pressure pp;
+
+	yassert_i32_eq(psi_do_read_pressure(&pp), PSI_ALL_OKAY);
+	yassert_f64_eq(pp.some.avg10, 1.25);
+	yassert_f64_eq(pp.some.avg60, 0.5);
+	yassert_f64_eq(pp.some.avg300, 0.25);
+	yassert_u64_eq(pp.some.total, 123456);
+	yassert_f64_eq(pp.full.avg10, 0.75);
+	yassert_f64_eq(pp.full.avg300, 0.0);
+	yassert_u64_eq(pp.full.total, 65432);
+}
+
+YTEST(emulated_trigger_fires)
+{
+	struct psi_monitor pm;
+	char path[64];
+
+	test_write_totals(path, sizeof(path), 1000, 1000);
+	psi_do_init(&pm);
+	/* A regular file can't raise POLLPRI: both are emulated. */
+	yassert_i32_eq(psi_do_add_trigger(&pm, PSI_SOME, 1000000, 10000),
+		       PSI_ALL_OKAY);
+	yassert_i32_eq(psi_do_add_trigger(&pm, PSI_FULL, 2000, 10000),
+		       PSI_ALL_OKAY);
+	yassert(pm.triggers[0].emulated && pm.triggers[1].emulated);
+	yassert(pm.fds[0].fd == -1 && pm.fds[1].fd == -1);
+
+	/* Below both thresholds. */
+	test_write_totals(path, sizeof(path), 2000, 2000);
+	yassert_i32_eq(psi_do_wait(&pm, 30, NULL), PSI_TIMEOUT);
+
+	/* Only the second one crosses its threshold. */
+	test_write_totals(path, sizeof(path), 3000, 5000);
+	yassert_i32_eq(psi_do_wait(&pm, 1000, NULL), 1);
+
+	psi_do_close(&pm);
+	unlink(path);
+}
+
+YTEST(missing_file)
+{
+	struct psi_monitor pm;
+	struct psi_pressure pp;
+
+	test_psi_path = FIXTURES "/proc/no_such_file";
+	yassert_i32_eq(psi_do_read_pressure(&pp), PSI_OPEN_FAILED);
+	psi_do_init(&pm);
+	yassert_i32_eq(psi_do_add_trigger(&pm, PSI_SOME, 1000, 10000),
+		       PSI_OPEN_FAILED);
+	yassert_u64_eq(pm.ntriggers, 0);
+}
+
+YTEST_MAIN()
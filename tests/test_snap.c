@@ -0,0 +1,200 @@
+/* Snapshots that were tampered with are refused.
+   From the top directory:
+     cc -O2 -o test_snap tests/test_snap.c && ./test_snap */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SLL_IMPL
+#define DLIST_IMPL
+#define SS_IMPL
+#define SNAP_IMPL
+#define YTEST_IMPL
+#include "../snap.h"
+#include "../ytest.h"
+
+#define TEST_NELEMS    (8)
+
+static uint64_t test_data[TEST_NELEMS];
+
+/* Snapshot of a dlist of TEST_NELEMS elements, read back into buf.
+   Tests may run in parallel, each gets its own file. */
+static size_t test_snapshot(char *path, size_t len, char **buf)
+{
+	struct dlist *head;
+	FILE *fp;
+	long size;
+	int i;
+
+	snprintf(path, len, "/tmp/test_snap.%ld.snap", (long)getpid());
+	DLIST_DO_INIT(head);
+	for (i = TEST_NELEMS - 1; i >= 0; i--) {
+		test_data[i] = (uint64_t)i * 3;
+		DLIST_DO_PUSH_FRONT(head, &test_data[i]);
+	}
+	yassert_i32_eq(snap_do_write_dlist(path, head, sizeof(uint64_t), NULL),
+		       SNAP_ALL_OKAY);
+	DLIST_DO_FREE(head);
+
+	yassert((fp = fopen(path, "rb")) != NULL);
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+	yassert((*buf = malloc((size_t)size)) != NULL);
+	yassert(fread(*buf, (size_t)size, 1, fp) == 1);
+	fclose(fp);
+	return ((size_t)size);
+}
+
+static void test_rewrite(const char *path, const char *buf, size_t size)
+{
+	FILE *fp;
+
+	yassert((fp = fopen(path, "wb")) != NULL);
+	yassert(fwrite(buf, size, 1, fp) == 1);
+	fclose(fp);
+}
+
+/* Result of opening path with flags, and of thawing it if it opened. */
+static int test_open_thaw(const char *path, int flags)
+{
+	struct snap s;
+	struct dlist *head;
+	void *block;
+	int ret;
+
+	if ((ret = snap_do_open(&s, path, flags)) != SNAP_ALL_OKAY)
+		return (ret);
+	ret = snap_do_thaw_dlist(&s, &head, &block);
+	if (ret == SNAP_ALL_OKAY)
+		SNAP_FREE(block);
+	else
+		yassert(block == NULL);
+	snap_do_close(&s);
+	return (ret);
+}
+
+YTEST(round_trip)
+{
+	char path[64], *buf;
+	struct snap s;
+	struct dlist *head, *n;
+	void *block;
+	int i;
+
+	test_snapshot(path, sizeof(path), &buf);
+	yassert_i32_eq(snap_do_open(&s, path, 0), SNAP_ALL_OKAY);
+	yassert_u64_eq(SNAP_DO_COUNT(&s), TEST_NELEMS);
+	yassert_i32_eq(snap_do_thaw_dlist(&s, &head, &block), SNAP_ALL_OKAY);
+	for (n = head, i = 0; n != NULL; n = n->next, i++)
+		yassert_u64_eq(*(uint64_t *)n->data, (uint64_t)i * 3);
+	yassert_i32_eq(i, TEST_NELEMS);
+	SNAP_FREE(block);
+	snap_do_close(&s);
+	unlink(path);
+	free(buf);
+}
+
+YTEST(header_is_checksummed)
+{
+	char path[64], *buf;
+	struct snap_hdr *h;
+	size_t size;
+
+	size = test_snapshot(path, sizeof(path), &buf);
+	h = (struct snap_hdr *)buf;
+	h->data_size -= 8;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, 0), SNAP_BAD_CHECKSUM);
+	unlink(path);
+	free(buf);
+}
+
+YTEST(count_must_match)
+{
+	char path[64], *buf;
+	struct snap_hdr *h;
+	size_t size;
+
+	size = test_snapshot(path, sizeof(path), &buf);
+	h = (struct snap_hdr *)buf;
+	h->count = TEST_NELEMS + 1;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, SNAP_NO_VERIFY), SNAP_BAD_FORMAT);
+	h->count = TEST_NELEMS - 1;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, SNAP_NO_VERIFY), SNAP_BAD_FORMAT);
+	unlink(path);
+	free(buf);
+}
+
+YTEST(kind_is_checked)
+{
+	char path[64], *buf;
+	struct snap_hdr *h;
+	size_t size;
+
+	size = test_snapshot(path, sizeof(path), &buf);
+	h = (struct snap_hdr *)buf;
+	h->kind = 42;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, SNAP_NO_VERIFY), SNAP_BAD_FORMAT);
+	unlink(path);
+	free(buf);
+}
+
+YTEST(offsets_must_be_aligned)
+{
+	char path[64], *buf;
+	struct snap_hdr *h;
+	struct snap_rec *r;
+	size_t size;
+
+	size = test_snapshot(path, sizeof(path), &buf);
+	h = (struct snap_hdr *)buf;
+	r = (struct snap_rec *)(buf + h->first);
+	r->next += 4;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, SNAP_NO_VERIFY), SNAP_BAD_FORMAT);
+	r->next -= 4;
+	r->prev = 4;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, SNAP_NO_VERIFY), SNAP_BAD_FORMAT);
+	unlink(path);
+	free(buf);
+}
+
+YTEST(offsets_point_past_the_header)
+{
+	char path[64], *buf;
+	struct snap_hdr *h;
+	struct snap_rec *r;
+	const struct snap_rec *b;
+	struct snap s;
+	size_t size, n;
+
+	size = test_snapshot(path, sizeof(path), &buf);
+	h = (struct snap_hdr *)buf;
+	h->last = 8;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(test_open_thaw(path, SNAP_NO_VERIFY), SNAP_BAD_FORMAT);
+
+	/* A backward walk stops instead of reading the header. */
+	h->last = h->first;
+	r = (struct snap_rec *)(buf + h->first);
+	r->prev = 8;
+	test_rewrite(path, buf, size);
+	yassert_i32_eq(snap_do_open(&s, path, SNAP_NO_VERIFY), SNAP_ALL_OKAY);
+	n = 0;
+	SNAP_DO_FOREACH_BACKWARD(&s, b)
+		n++;
+	yassert_u64_eq(n, 1);
+	snap_do_close(&s);
+	unlink(path);
+	free(buf);
+}
+
+YTEST_MAIN()
@@ -0,0 +1,304 @@
+/* Hot-path tracing: scopes, counters and instant events are written
+   into per-thread ring buffers, and flushed on demand as Chrome trace
+   (chrome://tracing, Perfetto) JSON.
+
+   The macros compile to nothing unless TRACE_ENABLE is defined.
+   Define SLL_TRACE, DLIST_TRACE, SS_TRACE or PROC_TRACE before
+   including those headers to trace their functions. Needs -pthread. */
+#ifndef TRACE_H
+# define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Events kept per thread, must be a power of two. Once a ring is
+   full the oldest events are overwritten, and counted as dropped. */
+#ifndef TRACE_RING_SIZE
+# define TRACE_RING_SIZE      (16384)
+#endif
+
+/* Event types, the Chrome trace "ph" values. */
+#define TRACE_PH_BEGIN        ('B')
+#define TRACE_PH_END          ('E')
+#define TRACE_PH_COUNTER      ('C')
+#define TRACE_PH_INSTANT      ('i')
+
+#ifdef TRACE_ENABLE
+
+#include <stdatomic.h>
+
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+# define TRACE_HAVE_TSC
+#else
+# include <time.h>
+#endif
+
+struct trace_event {
+	/* TSC ticks, or nanoseconds without a TSC. */
+	uint64_t ts;
+	const char *name;
+	int64_t val;
+	int ph;
+};
+
+/* Written by its thread only, read by trace_do_flush(). */
+struct trace_ring {
+	_Atomic uint64_t head;
+	/* First event not flushed yet. */
+	_Atomic uint64_t tail;
+	/* Set once the thread exited, the ring is then reused. */
+	atomic_int dead;
+	int tid;
+	struct trace_ring *next;
+	struct trace_event ev[TRACE_RING_SIZE];
+};
+
+extern __thread struct trace_ring *trace_ring_self;
+
+/* Slow path of the first event of a thread. */
+extern struct trace_ring *trace_do_register_thread(void);
+/* Write the pending events of every thread as a Chrome trace JSON
+   document, and discard them. Returns the number of events. */
+extern size_t trace_do_flush(FILE *fp);
+
+static inline uint64_t trace_now(void)
+{
+#ifdef TRACE_HAVE_TSC
+	uint32_t lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return (((uint64_t)hi << 32) | lo);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+#endif /* TRACE_HAVE_TSC */
+}
+
+static inline void trace_do_emit(int ph, const char *name, int64_t val)
+{
+	struct trace_ring *r;
+	struct trace_event *e;
+	uint64_t h;
+
+	if ((r = trace_ring_self) == NULL &&
+	    (r = trace_do_register_thread()) == NULL)
+		return;
+
+	h = atomic_load_explicit(&r->head, memory_order_relaxed);
+	e = &r->ev[h & (TRACE_RING_SIZE - 1)];
+	e->ts = trace_now();
+	e->name = name;
+	e->val = val;
+	e->ph = ph;
+	/* Publish the event to the flushing thread. */
+	atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+static inline void trace_scope_end(const char **name)
+{
+	trace_do_emit(TRACE_PH_END, *name, 0);
+}
+
+# define TRACE_CAT_(a, b)     a##b
+# define TRACE_CAT(a, b)      TRACE_CAT_(a, b)
+
+/* name must outlive the flush, a string literal or __func__. */
+# define TRACE_BEGIN(name)    trace_do_emit(TRACE_PH_BEGIN, name, 0)
+# define TRACE_END(name)      trace_do_emit(TRACE_PH_END, name, 0)
+# define TRACE_COUNTER(name, val)				\
+	trace_do_emit(TRACE_PH_COUNTER, name, (int64_t)(val))
+# define TRACE_INSTANT(name)  trace_do_emit(TRACE_PH_INSTANT, name, 0)
+/* Begin now, end when the enclosing block is left. This is a
+   declaration, put it after the other ones. */
+# define TRACE_SCOPE(name)						\
+	const char *TRACE_CAT(trace_scope_, __LINE__)			\
+	__attribute__((cleanup(trace_scope_end))) =			\
+		(trace_do_emit(TRACE_PH_BEGIN, name, 0), name)
+
+#else
+
+# define TRACE_BEGIN(name)           do { } while (0)
+# define TRACE_END(name)             do { } while (0)
+# define TRACE_COUNTER(name, val)    do { } while (0)
+# define TRACE_INSTANT(name)         do { } while (0)
+# define TRACE_SCOPE(name)
+
+#endif /* TRACE_ENABLE */
+
+#if defined (TRACE_ENABLE) && defined (TRACE_IMPL)
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+__thread struct trace_ring *trace_ring_self;
+
+static _Atomic(struct trace_ring *) trace_rings;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static pthread_mutex_t trace_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Reference point of the timestamps. */
+static uint64_t trace_ts0, trace_ns0;
+static uint64_t trace_dropped;
+
+static uint64_t trace_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+/* Thread exit. */
+static void trace_release_ring(void *arg)
+{
+	struct trace_ring *r = arg;
+
+	trace_ring_self = NULL;
+	atomic_store_explicit(&r->dead, 1, memory_order_release);
+}
+
+static void trace_init(void)
+{
+	pthread_key_create(&trace_key, trace_release_ring);
+	trace_ts0 = trace_now();
+	trace_ns0 = trace_clock_ns();
+}
+
+struct trace_ring *trace_do_register_thread(void)
+{
+	struct trace_ring *r, *head;
+	int dead;
+
+	pthread_once(&trace_once, trace_init);
+
+	/* Reuse the ring of an exited thread once it was flushed. */
+	for (r = atomic_load(&trace_rings); r != NULL; r = r->next) {
+		dead = 1;
+		if (atomic_load(&r->head) == atomic_load(&r->tail) &&
+		    atomic_compare_exchange_strong(&r->dead, &dead, 0))
+			break;
+	}
+
+	if (r == NULL) {
+		if ((r = malloc(sizeof(struct trace_ring))) == NULL)
+			return (NULL);
+		atomic_init(&r->head, 0);
+		atomic_init(&r->tail, 0);
+		atomic_init(&r->dead, 0);
+		head = atomic_load(&trace_rings);
+		do {
+			r->next = head;
+		} while (!atomic_compare_exchange_weak(&trace_rings, &head, r));
+	}
+
+	r->tid = (int)syscall(SYS_gettid);
+	pthread_setspecific(trace_key, r);
+	trace_ring_self = r;
+	return (r);
+}
+
+static void trace_write_name(FILE *fp, const char *name)
+{
+	for (; *name != '\0'; name++) {
+		if (*name == '"' || *name == '\\')
+			fputc('\\', fp);
+		fputc(*name, fp);
+	}
+}
+
+/* Copy the pending events of a ring, returns how many were kept. */
+static size_t trace_copy_ring(struct trace_ring *r, struct trace_event *out)
+{
+	uint64_t tail, h1, h2, i, first;
+
+	tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	h1 = atomic_load_explicit(&r->head, memory_order_acquire);
+	first = h1 - tail > TRACE_RING_SIZE ? h1 - TRACE_RING_SIZE : tail;
+	trace_dropped += first - tail;
+
+	for (i = first; i < h1; i++)
+		out[i - first] = r->ev[i & (TRACE_RING_SIZE - 1)];
+
+	/* The thread kept going while we copied, anything it may have
+	   overwritten in the meantime is dropped. That includes slot h2,
+	   which it may be writing right now. */
+	atomic_thread_fence(memory_order_acquire);
+	h2 = atomic_load_explicit(&r->head, memory_order_relaxed);
+	if (h2 + 1 - first > TRACE_RING_SIZE) {
+		i = h2 + 1 - TRACE_RING_SIZE - first;
+		if (i > h1 - first)
+			i = h1 - first;
+		trace_dropped += i;
+		memmove(out, out + i, (size_t)(h1 - first - i) *
+			sizeof(struct trace_event));
+		first += i;
+	}
+
+	atomic_store_explicit(&r->tail, h1, memory_order_relaxed);
+	return ((size_t)(h1 - first));
+}
+
+size_t trace_do_flush(FILE *fp)
+{
+	struct trace_ring *r;
+	struct trace_event *evs;
+	double us_per_tick;
+	uint64_t ts, ns;
+	size_t i, n, nevents;
+	int pid;
+
+	pthread_once(&trace_once, trace_init);
+	if ((evs = malloc(TRACE_RING_SIZE * sizeof(struct trace_event))) == NULL)
+		return (0);
+
+	pthread_mutex_lock(&trace_flush_lock);
+#ifdef TRACE_HAVE_TSC
+	/* Calibrate the TSC against the monotonic clock, over at least
+	   10ms. */
+	while ((ns = trace_clock_ns()) - trace_ns0 < 10 * 1000 * 1000)
+		usleep(1000);
+	ts = trace_now();
+	us_per_tick = (double)(ns - trace_ns0) / (double)(ts - trace_ts0) / 1e3;
+#else
+	(void)ts;
+	(void)ns;
+	us_per_tick = 1e-3;
+#endif /* TRACE_HAVE_TSC */
+
+	pid = (int)getpid();
+	nevents = 0;
+	fprintf(fp, "{\"traceEvents\": [");
+	for (r = atomic_load(&trace_rings); r != NULL; r = r->next) {
+		n = trace_copy_ring(r, evs);
+		for (i = 0; i < n; i++, nevents++) {
+			fprintf(fp, "%s\n  {\"name\": \"", nevents == 0 ? "" : ",");
+			trace_write_name(fp, evs[i].name);
+			fprintf(fp, "\", \"ph\": \"%c\", \"ts\": %.3f, "
+				"\"pid\": %d, \"tid\": %d", evs[i].ph,
+				(double)(int64_t)(evs[i].ts - trace_ts0) *
+				us_per_tick, pid, r->tid);
+			if (evs[i].ph == TRACE_PH_COUNTER)
+				fprintf(fp, ", \"args\": {\"value\": %lld}",
+					(long long)evs[i].val);
+			else if (evs[i].ph == TRACE_PH_INSTANT)
+				fprintf(fp, ", \"s\": \"t\"");
+			fprintf(fp, "}");
+		}
+	}
+	fprintf(fp, "\n], \"displayTimeUnit\": \"ns\", "
+		"\"otherData\": {\"dropped\": %llu}}\n",
+		(unsigned long long)trace_dropped);
+	pthread_mutex_unlock(&trace_flush_lock);
+
+	free(evs);
+	return (nevents);
+}
+
+#endif /* TRACE_ENABLE && TRACE_IMPL */
+
+#endif /* TRACE_H */
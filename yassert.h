@@ -7,6 +7,7 @@
 #endif
 
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -20,23 +21,75 @@ extern const char *__progname;
 # define __YASSERT_PROGRAM_NAME    __progname
 #endif
 
-#define __yassert_do_internal(arg)					\
+/* Assertion levels, selected at compile time with YASSERT_LEVEL.
+   OFF doesn't evaluate the expressions at all, CHEAP only reports the
+   file and line of a failure, FULL also reports the expression and
+   the function. */
+#define YASSERT_LEVEL_OFF      (0)
+#define YASSERT_LEVEL_CHEAP    (1)
+#define YASSERT_LEVEL_FULL     (2)
+
+#ifndef YASSERT_LEVEL
+# define YASSERT_LEVEL    YASSERT_LEVEL_FULL
+#endif
+
+#if defined (__GNUC__)
+# define __yassert_unlikely(x)    __builtin_expect(!!(x), 0)
+# define __YASSERT_COLD						\
+	__attribute__((noinline, cold, noreturn, unused))
+#else
+# define __yassert_unlikely(x)    (x)
+# define __YASSERT_COLD
+#endif
+
+/* Failure path, kept out of line so that call sites only contain
+   the test and a call. */
+static __YASSERT_COLD void __yassert_fail(const char *expr, const char *file,
+					  int line, const char *func)
+{
+	if (expr != NULL)
+		fprintf(stderr, "%s: %s:%d: %s: Assertion '%s' failed.\n",
+			__YASSERT_PROGRAM_NAME, file, line, func, expr);
+	else
+		fprintf(stderr, "%s: %s:%d: Assertion failed.\n",
+			__YASSERT_PROGRAM_NAME, file, line);
+	abort();
+}
+
+#if YASSERT_LEVEL >= YASSERT_LEVEL_FULL
+# define __yassert_do_internal(arg)					\
+	do {								\
+		if (__yassert_unlikely(!(arg)))				\
+			__yassert_fail(#arg, __FILE__, __LINE__,	\
+				       __FUNCTION__);			\
+	} while (0)
+#elif YASSERT_LEVEL == YASSERT_LEVEL_CHEAP
+# define __yassert_do_internal(arg)					\
 	do {								\
-		if (!(arg)) {						\
-			fprintf(stderr,					\
-				"%s: %s:%d: %s: Assertion '"#arg"' failed.\n", \
-			        __YASSERT_PROGRAM_NAME, __FILE__, \
-				__LINE__, __FUNCTION__);		\
-			abort();					\
-		}							\
+		if (__yassert_unlikely(!(arg)))				\
+			__yassert_fail(NULL, __FILE__, __LINE__, NULL);	\
 	} while (0)
+#else
+/* Not evaluated, but still type checked. */
+# define __yassert_do_internal(arg)		\
+	do { (void)sizeof(!(arg)); } while (0)
+#endif
 
 #define yassert(expr)				\
 	__yassert_do_internal(expr)
 
+/* Expensive checks, only done at the FULL level. */
+#if YASSERT_LEVEL >= YASSERT_LEVEL_FULL
+# define yassert_full(expr)			\
+	__yassert_do_internal(expr)
+#else
+# define yassert_full(expr)			\
+	do { (void)sizeof(!(expr)); } while (0)
+#endif
+
 /* Assert true, if the value is > than 0. */
 #define yassert_true(val)				\
-	__yassert_do_internal((int32_t)val > 0); }
+	__yassert_do_internal((int32_t)val > 0)
 
 /* Assert false, if the value is equal to 0. */
 #define yassert_false(val)				\
@@ -74,8 +127,19 @@ extern const char *__progname;
 #define yassert_cp_noncase_eq(left, right)			\
 	__yassert_do_internal(strcasecmp(left, right) == 0)
 
+/* The checks below aren't a single expression: at the OFF level only
+   their operands are type checked, so that neither the loop nor the
+   lookup is done. */
+#if YASSERT_LEVEL == YASSERT_LEVEL_OFF
+# define yassert_static_narr_eq(left, right)			\
+	do { (void)sizeof((left)[0] == (right)[0]); } while (0)
+# define yassert_c_contains(left, right)			\
+	do { (void)sizeof(strchr(left, right)); } while (0)
+# define yassert_cp_contains(left, right)			\
+	do { (void)sizeof(strstr(left, right)); } while (0)
+#else
 /* Test whether two static arrays contains similar values or not. */
-#define yassert_static_narr_eq(left, right)				\
+# define yassert_static_narr_eq(left, right)				\
 	do {								\
 		size_t i;						\
 	        for (i = 0; i < sizeof(left)/sizeof(*left); i++)	\
@@ -83,17 +147,18 @@ extern const char *__progname;
 	} while (0)
 
 /* Check whether haystack (char pointer) contains a needle (single character). */
-#define yassert_c_contains(left, right)				\
+# define yassert_c_contains(left, right)				\
 	do {							\
 		if (strchr(left, right) == NULL)		\
 			__yassert_do_internal(left == right);	\
 	} while (0)
 
 /* Check whether haystack (char pointer) contains a needle (char pointer). */
-#define yassert_cp_contains(left, right)			\
+# define yassert_cp_contains(left, right)			\
 	do {							\
 		if (strstr(left, right) == NULL)		\
 			__yassert_do_internal(left == right);	\
 	} while (0)
+#endif
 
 #endif /* YASSERT_H */
@@ -0,0 +1,352 @@
+/* Test registration and a forking, parallel runner for yassert.h
+   based tests. A failing yassert() only kills the child running that
+   test. */
+#ifndef YTEST_H
+# define YTEST_H
+
+#include "yassert.h"
+
+/* Default number of seconds after which a test is killed. */
+#ifndef YTEST_TIMEOUT
+# define YTEST_TIMEOUT        (10)
+#endif
+
+/* Output kept per test, the rest is dropped. */
+#ifndef YTEST_MAX_OUTPUT
+# define YTEST_MAX_OUTPUT     (64 * 1024)
+#endif
+
+/* Milliseconds spent reading the output left once a test exited. A
+   process it started might still hold the pipe open. */
+#ifndef YTEST_DRAIN_MS
+# define YTEST_DRAIN_MS       (100)
+#endif
+
+typedef void (*ytest_fn)(void);
+
+/* Register a test, called by YTEST() before main(). */
+extern void ytest_do_register(const char *name, ytest_fn fn,
+			      const char *file, int line);
+/* Run the registered tests. Options:
+     -j N    number of tests run at once (default: number of CPUs)
+     -t SEC  timeout per test (default: YTEST_TIMEOUT)
+     NAME    only run tests whose name contains NAME
+   Returns 0 if every test passed, 1 otherwise. */
+extern int ytest_do_run_all(int argc, char **argv);
+
+/* Define a test:
+     YTEST(push_back) { ... yassert(...); ... } */
+#define YTEST(name)							\
+	static void ytest_##name(void);					\
+	__attribute__((constructor)) static void ytest_reg_##name(void)	\
+	{								\
+		ytest_do_register(#name, ytest_##name, __FILE__, __LINE__); \
+	}								\
+	static void ytest_##name(void)
+
+#define YTEST_MAIN()						\
+	int main(int argc, char **argv)				\
+	{							\
+		return (ytest_do_run_all(argc, argv));		\
+	}
+
+#ifdef YTEST_IMPL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+struct ytest {
+	const char *name;
+	ytest_fn fn;
+	const char *file;
+	int line;
+};
+
+struct ytest_slot {
+	size_t idx;
+	pid_t pid;
+	/* Read end of the child's stdout/stderr, -1 at EOF. */
+	int fd;
+	int timed_out;
+	uint64_t start_ns;
+	char *out;
+	size_t len;
+};
+
+static struct ytest *ytest_tests;
+static size_t ytest_ntests;
+
+void ytest_do_register(const char *name, ytest_fn fn, const char *file,
+		       int line)
+{
+	struct ytest *t;
+
+	t = realloc(ytest_tests, (ytest_ntests + 1) * sizeof(struct ytest));
+	if (t == NULL)
+		abort();
+	ytest_tests = t;
+	ytest_tests[ytest_ntests].name = name;
+	ytest_tests[ytest_ntests].fn = fn;
+	ytest_tests[ytest_ntests].file = file;
+	ytest_tests[ytest_ntests].line = line;
+	ytest_ntests++;
+}
+
+static uint64_t ytest_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+static int ytest_start(struct ytest_slot *s, size_t idx)
+{
+	int fds[2];
+
+	if (pipe(fds) == -1)
+		return (-1);
+	/* Programs the other tests run don't need our end. */
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+	/* Don't let the child flush our buffers a second time. */
+	fflush(stdout);
+	fflush(stderr);
+	if ((s->pid = fork()) == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		return (-1);
+	}
+
+	if (s->pid == 0) {
+		close(fds[0]);
+		dup2(fds[1], STDOUT_FILENO);
+		dup2(fds[1], STDERR_FILENO);
+		close(fds[1]);
+		/* Keep the output of a test that aborts. */
+		setvbuf(stdout, NULL, _IONBF, 0);
+		ytest_tests[idx].fn();
+		fflush(stdout);
+		_exit(0);
+	}
+
+	close(fds[1]);
+	s->idx = idx;
+	s->fd = fds[0];
+	s->timed_out = 0;
+	s->start_ns = ytest_now_ns();
+	s->out = NULL;
+	s->len = 0;
+	return (0);
+}
+
+static void ytest_drain(struct ytest_slot *s)
+{
+	char buf[4096];
+	ssize_t n;
+	char *p;
+
+	n = read(s->fd, buf, sizeof(buf));
+	if (n == -1 && errno == EINTR)
+		return;
+	if (n <= 0) {
+		close(s->fd);
+		s->fd = -1;
+		return;
+	}
+
+	if (s->len + (size_t)n > YTEST_MAX_OUTPUT)
+		n = (ssize_t)(YTEST_MAX_OUTPUT - s->len);
+	if (n == 0 || (p = realloc(s->out, s->len + (size_t)n)) == NULL)
+		return;
+	memcpy(p + s->len, buf, (size_t)n);
+	s->out = p;
+	s->len += (size_t)n;
+}
+
+/* Read what's left in the pipe of a test that exited, for at most
+   YTEST_DRAIN_MS. */
+static void ytest_drain_rest(struct ytest_slot *s)
+{
+	struct pollfd pfd;
+	uint64_t deadline, now;
+	int r;
+
+	deadline = ytest_now_ns() + (uint64_t)YTEST_DRAIN_MS * 1000000;
+	while (s->fd != -1) {
+		now = ytest_now_ns();
+		pfd.fd = s->fd;
+		pfd.events = POLLIN;
+		r = now < deadline ?
+			poll(&pfd, 1, (int)((deadline - now) / 1000000) + 1) : 0;
+		if (r == -1 && errno == EINTR)
+			continue;
+		if (r <= 0) {
+			close(s->fd);
+			s->fd = -1;
+			break;
+		}
+		ytest_drain(s);
+	}
+}
+
+/* Print the outcome of a finished test, returns 1 if it passed. */
+static int ytest_report(const struct ytest_slot *s, int status)
+{
+	const struct ytest *t;
+	double ms;
+	int ok;
+
+	t = &ytest_tests[s->idx];
+	ms = (double)(ytest_now_ns() - s->start_ns) / 1e6;
+	ok = !s->timed_out && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+	if (ok)
+		printf("[PASS] %s (%.1f ms)\n", t->name, ms);
+	else if (s->timed_out)
+		printf("[TIME] %s (%s:%d) killed after %.1f ms\n", t->name,
+		       t->file, t->line, ms);
+	else if (WIFSIGNALED(status))
+		printf("[FAIL] %s (%s:%d) %s\n", t->name, t->file, t->line,
+		       WTERMSIG(status) == SIGABRT ? "aborted" :
+		       strsignal(WTERMSIG(status)));
+	else
+		printf("[FAIL] %s (%s:%d) exit status %d\n", t->name, t->file,
+		       t->line, WEXITSTATUS(status));
+
+	if (!ok && s->len > 0) {
+		fwrite(s->out, 1, s->len, stdout);
+		if (s->out[s->len - 1] != '\n')
+			printf("\n");
+	}
+	return (ok);
+}
+
+int ytest_do_run_all(int argc, char **argv)
+{
+	struct ytest_slot *slots;
+	struct pollfd *pfds;
+	const char *filter;
+	size_t i, next, njobs, nrunning, npassed, nfailed, nrun;
+	long timeout, ncpu;
+	int status, ms;
+	uint64_t start, now, deadline;
+
+	njobs = 0;
+	timeout = YTEST_TIMEOUT;
+	filter = NULL;
+	for (i = 1; i < (size_t)argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < (size_t)argc)
+			njobs = (size_t)atol(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < (size_t)argc)
+			timeout = atol(argv[++i]);
+		else
+			filter = argv[i];
+	}
+	if (njobs == 0) {
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		njobs = ncpu > 0 ? (size_t)ncpu : 1;
+	}
+
+	slots = calloc(njobs, sizeof(struct ytest_slot));
+	pfds = calloc(njobs, sizeof(struct pollfd));
+	if (slots == NULL || pfds == NULL) {
+		free(slots);
+		free(pfds);
+		return (1);
+	}
+	for (i = 0; i < njobs; i++)
+		slots[i].pid = -1;
+
+	start = ytest_now_ns();
+	next = 0;
+	nrunning = npassed = nfailed = nrun = 0;
+	for (;;) {
+		/* Fill the free slots. */
+		for (i = 0; i < njobs && next < ytest_ntests; i++) {
+			if (slots[i].pid != -1)
+				continue;
+			while (next < ytest_ntests && filter != NULL &&
+			       strstr(ytest_tests[next].name, filter) == NULL)
+				next++;
+			if (next == ytest_ntests)
+				break;
+			if (ytest_start(&slots[i], next++) == -1) {
+				printf("[FAIL] %s: fork failed\n",
+				       ytest_tests[next - 1].name);
+				nfailed++;
+				nrun++;
+				continue;
+			}
+			nrunning++;
+		}
+		if (nrunning == 0)
+			break;
+
+		/* Wait for output, or for the nearest deadline. */
+		now = ytest_now_ns();
+		ms = 100;
+		for (i = 0; i < njobs; i++) {
+			pfds[i].fd = slots[i].pid != -1 ? slots[i].fd : -1;
+			pfds[i].events = POLLIN;
+			if (slots[i].pid == -1 || slots[i].timed_out)
+				continue;
+			/* Closed its output, it's about to exit. */
+			if (slots[i].fd == -1 && ms > 1)
+				ms = 1;
+			deadline = slots[i].start_ns +
+				(uint64_t)timeout * 1000000000;
+			if (deadline <= now)
+				ms = 0;
+			else if ((deadline - now) / 1000000 < (uint64_t)ms)
+				ms = (int)((deadline - now) / 1000000) + 1;
+		}
+		poll(pfds, (nfds_t)njobs, ms);
+
+		now = ytest_now_ns();
+		for (i = 0; i < njobs; i++) {
+			if (slots[i].pid == -1)
+				continue;
+			if (slots[i].fd != -1 && (pfds[i].revents & (POLLIN | POLLHUP)))
+				ytest_drain(&slots[i]);
+
+			if (!slots[i].timed_out && now - slots[i].start_ns >=
+			    (uint64_t)timeout * 1000000000) {
+				kill(slots[i].pid, SIGKILL);
+				slots[i].timed_out = 1;
+			}
+
+			if (waitpid(slots[i].pid, &status, WNOHANG) != slots[i].pid)
+				continue;
+			ytest_drain_rest(&slots[i]);
+
+			if (ytest_report(&slots[i], status))
+				npassed++;
+			else
+				nfailed++;
+			nrun++;
+			free(slots[i].out);
+			slots[i].pid = -1;
+			nrunning--;
+		}
+	}
+
+	printf("%zu tests, %zu passed, %zu failed (%.1f ms, %zu jobs)\n",
+	       nrun, npassed, nfailed,
+	       (double)(ytest_now_ns() - start) / 1e6, njobs);
+	free(slots);
+	free(pfds);
+	return (nfailed > 0);
+}
+
+#endif /* YTEST_IMPL */
+
+#endif /* YTEST_H */